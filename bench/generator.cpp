@@ -0,0 +1,172 @@
+#include "generator.h"
+#include <algorithm>
+#include <vector>
+
+
+namespace {
+
+class Random {
+private:
+    uint64_t state;
+
+public:
+    Random(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    unsigned below(unsigned n) { return static_cast<unsigned>(next() % n); }
+    bool chance(unsigned percent) { return below(100) < percent; }
+};
+
+class Generator {
+private:
+    const GenConfig& config;
+    Random random;
+    std::string out;
+
+    void identifier() {
+        out += 'v';
+        out += std::to_string(random.below(config.identifiers));
+    }
+
+    void leaf() {
+        if (random.chance(70)) {
+            identifier();
+        } else {
+            out += std::to_string(random.below(1000));
+        }
+    }
+
+    // Left-deep chains with parenthesized right subtrees, so code generation
+    // has to spill as the depth grows.
+    void expression(unsigned depth) {
+        if (depth <= 1) {
+            leaf();
+            return;
+        }
+        expression(depth - 1);
+        out += random.chance(50) ? " + " : " - ";
+        if (depth > 2 && random.chance(50)) {
+            out += '(';
+            expression(depth - 1);
+            out += ')';
+        } else {
+            leaf();
+        }
+    }
+
+    void indent(size_t depth) {
+        out.append(4 * std::min<size_t>(depth, 8), ' ');
+    }
+
+    void simpleStatement(size_t depth, bool topLevel) {
+        indent(depth);
+        unsigned kind = random.below(100);
+        if (topLevel && kind < 15) {
+            out += "int ";
+            identifier();
+        } else if (kind < 45) {
+            out += "int ";
+            identifier();
+            out += " = ";
+            expression(config.exprDepth);
+        } else {
+            identifier();
+            out += " = ";
+            expression(config.exprDepth);
+        }
+        out += ";\n";
+    }
+
+    void openIf(size_t depth) {
+        indent(depth);
+        out += "if (";
+        identifier();
+        out += " == ";
+        if (random.chance(50)) {
+            identifier();
+        } else {
+            out += std::to_string(random.below(10));
+        }
+        out += ") {\n";
+    }
+
+public:
+    Generator(const GenConfig& config) : config(config), random(config.seed) {}
+
+    // Iterative so that any if depth can be generated without recursion.
+    // Every if opened below the configured depth starts its then-body with
+    // another if, so each top-level if reaches exactly that depth.
+    std::string run() {
+        struct OpenIf {
+            unsigned bodyLeft;
+            bool inElse;
+        };
+        std::vector<OpenIf> open;
+        size_t remaining = config.statements;
+
+        while (remaining > 0 || !open.empty()) {
+            if (!open.empty() && (open.back().bodyLeft == 0 || remaining == 0)) {
+                OpenIf& top = open.back();
+                if (!top.inElse && remaining > 0) {
+                    indent(open.size() - 1);
+                    out += "} else {\n";
+                    top.inElse = true;
+                    top.bodyLeft = 1 + random.below(3);
+                } else {
+                    indent(open.size() - 1);
+                    out += "}\n";
+                    open.pop_back();
+                }
+                continue;
+            }
+
+            remaining--;
+            bool firstInThen = !open.empty() && !open.back().inElse && open.back().bodyLeft == ~0u;
+            if (!open.empty()) {
+                if (firstInThen) open.back().bodyLeft = 1 + random.below(3);
+                open.back().bodyLeft--;
+            }
+
+            bool nestAllowed = open.size() < config.ifDepth;
+            bool startIf = nestAllowed && (open.empty() ? random.chance(20) : firstInThen);
+            if (startIf) {
+                openIf(open.size());
+                open.push_back({~0u, false});
+            } else {
+                simpleStatement(open.size(), open.empty());
+            }
+        }
+        return std::move(out);
+    }
+};
+
+}
+
+
+std::string generateProgram(const GenConfig& config) {
+    return Generator(config).run();
+}
+
+bool parseGenOption(const std::string& arg, GenConfig& config) {
+    auto value = [&](const char* prefix) { return std::stoull(arg.substr(std::string(prefix).size())); };
+    if (arg.rfind("--statements=", 0) == 0) {
+        config.statements = value("--statements=");
+    } else if (arg.rfind("--expr-depth=", 0) == 0) {
+        config.exprDepth = static_cast<unsigned>(std::max(1ull, value("--expr-depth=")));
+    } else if (arg.rfind("--if-depth=", 0) == 0) {
+        config.ifDepth = static_cast<unsigned>(value("--if-depth="));
+    } else if (arg.rfind("--identifiers=", 0) == 0) {
+        config.identifiers = static_cast<unsigned>(std::max(1ull, value("--identifiers=")));
+    } else if (arg.rfind("--seed=", 0) == 0) {
+        config.seed = value("--seed=");
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,27 @@
+// generator.h - Synthetic SimpleLang programs for benchmarks
+
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <cstdint>
+#include <string>
+
+// Shape of a generated program. Every statement, including those inside if
+// bodies, counts towards `statements`.
+struct GenConfig {
+    size_t statements = 100000;
+    unsigned exprDepth = 3;         // depth of binary-operator trees; 1 = a single operand
+    unsigned ifDepth = 2;           // maximum nesting of if statements; 0 = no ifs
+    unsigned identifiers = 200;     // distinct variable names
+    uint64_t seed = 1;
+};
+
+// Returns the same text for the same config on every platform: the random
+// stream is a fixed splitmix64, not a standard-library distribution.
+std::string generateProgram(const GenConfig& config);
+
+// Reads "--statements=N", "--expr-depth=N", "--if-depth=N", "--identifiers=N"
+// or "--seed=N" into `config`. Returns false if `arg` is none of these.
+bool parseGenOption(const std::string& arg, GenConfig& config);
+
+#endif
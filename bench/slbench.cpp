@@ -0,0 +1,180 @@
+// slbench - per-phase compiler throughput on generated workloads
+//
+// Each workload is generated once, written to a temporary file, then
+// compiled --warmup times untimed and --reps times timed through the same
+// compileFile the compiler uses. The per-phase numbers are the ones
+// --time-report prints; this program only repeats them and summarizes.
+
+#include "generator.h"
+#include "driver.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+
+namespace {
+
+struct Workload {
+    const char* name;
+    GenConfig config;
+};
+
+struct Summary {
+    double median = 0;
+    double min = 0;
+    double mean = 0;
+    double stddev = 0;
+};
+
+Summary summarize(std::vector<double> samples) {
+    Summary s;
+    if (samples.empty()) return s;
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    s.min = samples[0];
+    s.median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    for (double x : samples) s.mean += x;
+    s.mean /= n;
+    if (n > 1) {
+        double sq = 0;
+        for (double x : samples) sq += (x - s.mean) * (x - s.mean);
+        s.stddev = std::sqrt(sq / (n - 1));
+    }
+    return s;
+}
+
+GenConfig shape(size_t statements, unsigned exprDepth, unsigned ifDepth) {
+    GenConfig config;
+    config.statements = statements;
+    config.exprDepth = exprDepth;
+    config.ifDepth = ifDepth;
+    return config;
+}
+
+// Returns false if any compilation fails.
+bool runWorkload(const Workload& w, const Options& opts, unsigned warmup, unsigned reps) {
+    std::string source = generateProgram(w.config);
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("slbench-" + std::to_string(getpid()) + "-" + w.name + ".sl")).string();
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(source.data(), source.size());
+    }
+
+    double mb = source.size() / (1024.0 * 1024.0);
+    std::printf("== %s: %zu statements, expr depth %u, if depth %u, %u identifiers (%.2f MB) ==\n",
+                w.name, w.config.statements, w.config.exprDepth, w.config.ifDepth,
+                w.config.identifiers, mb);
+
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> millis;
+    std::vector<uint64_t> allocs;
+    std::vector<double> totals;
+    bool ok = true;
+    for (unsigned rep = 0; rep < warmup + reps && ok; rep++) {
+        CompileResult result = compileFile(opts, path, "/dev/null", nullptr);
+        if (!result.ok) {
+            std::printf("  FAILED: %s\n", result.error.c_str());
+            ok = false;
+            break;
+        }
+        if (rep < warmup) continue;
+
+        double total = 0;
+        for (const PhaseStats& phase : result.phases) {
+            auto it = std::find(names.begin(), names.end(), phase.name);
+            size_t i = it - names.begin();
+            if (it == names.end()) {
+                names.push_back(phase.name);
+                millis.emplace_back();
+                allocs.push_back(phase.allocations);
+            }
+            millis[i].push_back(phase.millis);
+            total += phase.millis;
+        }
+        totals.push_back(total);
+    }
+    std::filesystem::remove(path);
+    if (!ok) return false;
+
+    uint64_t totalAllocs = 0;
+    for (uint64_t n : allocs) totalAllocs += n;
+    std::printf("  %-24s %10s %10s %10s %9s %10s %10s\n",
+                "phase", "median ms", "min ms", "mean ms", "stddev", "MB/s", "allocs");
+    for (size_t i = 0; i <= names.size(); i++) {
+        bool isTotal = i == names.size();
+        Summary s = summarize(isTotal ? totals : millis[i]);
+        // Phases that finish within timer resolution get no meaningful rate.
+        char rate[32] = "-";
+        if (s.median >= 0.01) std::snprintf(rate, sizeof(rate), "%.1f", mb / (s.median / 1000));
+        std::printf("  %-24s %10.3f %10.3f %10.3f %9.3f %10s %10llu\n",
+                    isTotal ? "total" : names[i].c_str(), s.median, s.min, s.mean, s.stddev, rate,
+                    (unsigned long long)(isTotal ? totalAllocs : allocs[i]));
+    }
+    std::printf("\n");
+    return true;
+}
+
+}
+
+
+int main(int argc, char* argv[]) {
+    unsigned warmup = 1;
+    unsigned reps = 5;
+    GenConfig custom;
+    bool hasCustom = false;
+
+    // Benchmark options are taken out here; the rest are compiler options.
+    std::vector<char*> compilerArgs = {argv[0]};
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg.rfind("--reps=", 0) == 0) {
+                reps = static_cast<unsigned>(std::max(1ul, std::stoul(arg.substr(7))));
+            } else if (arg.rfind("--warmup=", 0) == 0) {
+                warmup = static_cast<unsigned>(std::stoul(arg.substr(9)));
+            } else if (parseGenOption(arg, custom)) {
+                hasCustom = true;
+            } else {
+                compilerArgs.push_back(argv[i]);
+            }
+        }
+    } catch (const std::exception&) {
+        std::fprintf(stderr, "Error: Invalid option value\n");
+        return 1;
+    }
+
+    Options opts;
+    std::string error;
+    if (!parseOptions(static_cast<int>(compilerArgs.size()), compilerArgs.data(), opts, error) ||
+        !opts.inputs.empty()) {
+        std::fprintf(stderr, "Error: %s\n", error.empty() ? "unexpected input file" : error.c_str());
+        std::fprintf(stderr, "Usage: %s [--reps=N] [--warmup=N] [--statements=N] [--expr-depth=N]\n"
+                             "       [--if-depth=N] [--identifiers=N] [--seed=N] [compiler options]\n",
+                     argv[0]);
+        return 1;
+    }
+    // Turns on the separate lexing pass so the lexer gets a row of its own.
+    opts.timeReport = "text";
+
+    std::vector<Workload> workloads;
+    if (hasCustom) {
+        workloads.push_back({"custom", custom});
+    } else {
+        workloads.push_back({"flat", shape(200000, 2, 0)});
+        workloads.push_back({"deep-expr", shape(40000, 10, 0)});
+        workloads.push_back({"nested-if", shape(200000, 2, 12)});
+    }
+
+    std::printf("slbench: %u warmup + %u timed runs per workload\n\n", warmup, reps);
+    bool ok = true;
+    for (const Workload& w : workloads) {
+        ok = runWorkload(w, opts, warmup, reps) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,41 @@
+// slgen - writes a generated SimpleLang program to stdout or a file
+
+#include "generator.h"
+#include <fstream>
+#include <iostream>
+
+
+int main(int argc, char* argv[]) {
+    GenConfig config;
+    std::string outPath;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool ok;
+        try {
+            ok = parseGenOption(arg, config);
+            if (!ok && arg.rfind("-", 0) != 0 && outPath.empty()) {
+                outPath = arg;
+                ok = true;
+            }
+        } catch (const std::exception&) {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << "Usage: " << argv[0] << " [--statements=N] [--expr-depth=N] [--if-depth=N]\n"
+                      << "       [--identifiers=N] [--seed=N] [out.sl]\n";
+            return 1;
+        }
+    }
+
+    std::string program = generateProgram(config);
+    if (outPath.empty()) {
+        std::cout << program;
+        return 0;
+    }
+    std::ofstream out(outPath, std::ios::binary);
+    if (!out.write(program.data(), program.size())) {
+        std::cerr << "Error: Could not write " << outPath << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+// arena.h - Bump allocator that owns every AST node of one compilation
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Memory is handed out from large blocks in allocation order and released
+// all at once when the Arena is destroyed. Destructors of arena objects are
+// never run, so only trivially destructible types may be placed here.
+class Arena {
+private:
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* cur;
+    char* end;
+    size_t blockSize;
+    size_t used;
+    size_t reserved;
+    size_t objects;
+
+    void* allocateSlow(size_t size, size_t align);
+
+public:
+    Arena(size_t blockSize = 64 * 1024);
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t align) {
+        size_t adjust = (align - reinterpret_cast<size_t>(cur) % align) % align;
+        if (cur && static_cast<size_t>(end - cur) >= size + adjust) {
+            char* p = cur + adjust;
+            cur = p + size;
+            used += size + adjust;
+            return p;
+        }
+        return allocateSlow(size, align);
+    }
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible_v<T>,
+                      "arena objects are released without running destructors");
+        objects++;
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Copies `count` elements into one contiguous arena array.
+    template <typename T>
+    T* copyArray(const T* src, size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>, "arena arrays are copied bytewise");
+        if (count == 0) return nullptr;
+        T* dst = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        std::memcpy(dst, src, sizeof(T) * count);
+        return dst;
+    }
+
+    std::string_view copyString(std::string_view s) {
+        char* p = copyArray(s.data(), s.size());
+        return std::string_view(p, s.size());
+    }
+
+    // Takes over every block `other` has allocated, leaving it empty. Objects
+    // in those blocks stay where they are and now live as long as this arena.
+    void absorb(Arena& other);
+
+    size_t bytesUsed() const { return used; }
+    size_t bytesReserved() const { return reserved; }
+    size_t objectCount() const { return objects; }
+};
+
+#endif
@@ -4,10 +4,15 @@
 #define AST_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
-#include <unordered_map>
 #include <iostream>
+#include <cstdint>
+#include <utility>
+#include "arena.h"
+#include "context.h"
+#include "ir.h"
 
 // Forward declarations for visitor pattern
 class ASTVisitor;
@@ -23,15 +28,11 @@ class NumberLiteral;
 // ---------------- //
 // Base AST Node    //
 // ---------------- //
+// Nodes live in the Program's Arena and are never destroyed individually, so
+// they hold only pointers, string_views into the arena and plain values.
 class ASTNode {
 public:
-    virtual ~ASTNode() {}
     virtual void accept(ASTVisitor* visitor) = 0;
-
-    // Code generation methods
-    virtual void gencode(std::ostream& out) = 0;
-    virtual void gencodeL(std::ostream& out) = 0;
-    virtual void gencodeR(std::ostream& out) = 0;
 };
 
 // ---------------- //
@@ -49,48 +50,53 @@ public:
     virtual void visit(NumberLiteral* node) = 0;
 };
 
+// Contiguous, arena-allocated list of child statements
+struct NodeList {
+    ASTNode** items = nullptr;
+    uint32_t count = 0;
+
+    ASTNode** begin() const { return items; }
+    ASTNode** end() const { return items + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    ASTNode* operator[](size_t i) const { return items[i]; }
+};
+
 // ---------------- //
 // Program Node     //
 // ---------------- //
-class Program : public ASTNode {
+class Program final : public ASTNode {
 public:
-    std::vector<std::unique_ptr<ASTNode>> statements;
+    Arena arena;
+    NodeList statements;
 
     Program() {}
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
 
-    void addStatement(std::unique_ptr<ASTNode> stmt) {
-        statements.push_back(std::move(stmt));
-    }
+    // The final values of these variables are the program's result: every
+    // symbol declared at the top level, or never declared at all. Variables
+    // declared only inside if bodies are temporaries, dead after the last
+    // statement. Indexed by symbol ID. Only meaningful on the tree as
+    // parsed: the AST passes remove declarations.
+    std::vector<uint8_t> outputSymbols(size_t symbols) const;
 
-    void gencode(std::ostream& out) override;
-    void gencodeL(std::ostream& out) override {}
-    void gencodeR(std::ostream& out) override {}
+    // Lowers the whole program to three-address IR.
+    void lower(CompilationContext& ctx, IrBuilder& ir);
 };
 
 // ---------------- //
 // Expressions      //
 // ---------------- //
 class Expression : public ASTNode {
-public:
-    virtual ~Expression() {}
 };
 
 // Identifier (variable reference)
 class Identifier : public Expression {
 public:
-    std::string name;
-    int loc;
+    uint32_t sym;
 
-    static std::unordered_map<std::string, int> mem_map;
-    static int mem_loc;
-
-    Identifier(std::string n);
+    Identifier(uint32_t s) : sym(s) {}
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
-
-    void gencode(std::ostream& out) override;
-    void gencodeL(std::ostream& out) override;
-    void gencodeR(std::ostream& out) override;
 };
 
 // Number literal
@@ -100,105 +106,209 @@ public:
 
     NumberLiteral(int v) : value(v) {}
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
-
-    void gencode(std::ostream& out) override;
-    void gencodeL(std::ostream& out) override;
-    void gencodeR(std::ostream& out) override;
 };
 
 // Binary expression
 class BinaryExpr : public Expression {
 public:
-    std::unique_ptr<Expression> left;
-    std::string op;
-    std::unique_ptr<Expression> right;
+    Expression* left;
+    std::string_view op;
+    Expression* right;
 
-    BinaryExpr(std::unique_ptr<Expression> l, std::string o, std::unique_ptr<Expression> r)
-        : left(std::move(l)), op(o), right(std::move(r)) {}
+    BinaryExpr(Expression* l, std::string_view o, Expression* r)
+        : left(l), op(o), right(r) {}
 
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
-
-    void gencode(std::ostream& out) override;
-    void gencodeL(std::ostream& out) override {}
-    void gencodeR(std::ostream& out) override {}
 };
 
 // ---------------- //
 // Statements       //
 // ---------------- //
 class Statement : public ASTNode {
-public:
-    virtual ~Statement() {}
 };
 
 // VarDecl (int a;)
 class VarDecl : public Statement {
 public:
-    std::string name;
+    uint32_t sym;
 
-    VarDecl(std::string n) : name(n) {}
+    VarDecl(uint32_t s) : sym(s) {}
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
-
-    void gencode(std::ostream& out) override;
-    void gencodeL(std::ostream& out) override {}
-    void gencodeR(std::ostream& out) override {}
 };
 
 // VarDeclAssign (int a = expr;)
 class VarDeclAssign : public Statement {
 public:
-    std::string name;
-    std::unique_ptr<Expression> expr;
+    uint32_t sym;
+    Expression* expr;
 
-    VarDeclAssign(std::string n, std::unique_ptr<Expression> e)
-        : name(n), expr(std::move(e)) {}
+    VarDeclAssign(uint32_t s, Expression* e)
+        : sym(s), expr(e) {}
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
-
-    void gencode(std::ostream& out) override;
-    void gencodeL(std::ostream& out) override {}
-    void gencodeR(std::ostream& out) override {}
 };
 
 // AssignStmt (a = expr;)
 class AssignStmt : public Statement {
 public:
-    std::string varName;
-    std::unique_ptr<Expression> expr;
+    uint32_t sym;
+    Expression* expr;
 
-    AssignStmt(std::string var, std::unique_ptr<Expression> e)
-        : varName(var), expr(std::move(e)) {}
+    AssignStmt(uint32_t s, Expression* e)
+        : sym(s), expr(e) {}
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
-
-    void gencode(std::ostream& out) override;
-    void gencodeL(std::ostream& out) override {}
-    void gencodeR(std::ostream& out) override {}
 };
 
 // If statement
 class IfStmt : public Statement {
 public:
-    std::unique_ptr<Expression> condition;
-    std::vector<std::unique_ptr<ASTNode>> thenBody;
-    std::vector<std::unique_ptr<ASTNode>> elseBody;
+    Expression* condition;
+    NodeList thenBody;
+    NodeList elseBody;
 
-    IfStmt(std::unique_ptr<Expression> cond) : condition(std::move(cond)) {}
+    IfStmt(Expression* cond) : condition(cond) {}
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
+};
+
+// ---------------- //
+// Tree Walker      //
+// ---------------- //
+// Walks statement lists and expression trees with explicit stacks instead
+// of recursion, so nesting depth is bounded by memory rather than by the
+// thread's stack. Nodes are told apart through accept(), and the handler is
+// called with the node's own type:
+//
+//   statement(VarDecl*), statement(VarDeclAssign*), statement(AssignStmt*)
+//   beginIf(IfStmt*), elseIf(IfStmt*), endIf(IfStmt*)
+//   leaf(Identifier*), leaf(NumberLiteral*), binary(BinaryExpr*)
+//
+// The stacks are kept between walks; a pass creates one walker and reuses
+// it for every statement.
+class TreeWalker {
+private:
+    struct ListFrame {
+        IfStmt* node;           // null for the list the walk started from
+        ASTNode** next;
+        ASTNode** end;
+        bool inElse;
+    };
+    std::vector<ListFrame> lists;
+    std::vector<std::pair<Expression*, bool>> exprs;
+
+    template <typename Handler>
+    class StatementDispatch : public ASTVisitor {
+    public:
+        TreeWalker& walker;
+        Handler& h;
+
+        StatementDispatch(TreeWalker& walker, Handler& h) : walker(walker), h(h) {}
+
+        void visit(VarDecl* node) override { h.statement(node); }
+        void visit(VarDeclAssign* node) override { h.statement(node); }
+        void visit(AssignStmt* node) override { h.statement(node); }
+        void visit(IfStmt* node) override {
+            h.beginIf(node);
+            walker.lists.push_back({node, node->thenBody.begin(), node->thenBody.end(), false});
+        }
+        void visit(Program*) override {}
+        void visit(BinaryExpr*) override {}
+        void visit(Identifier*) override {}
+        void visit(NumberLiteral*) override {}
+    };
+
+    template <typename Handler>
+    class ExpressionDispatch : public ASTVisitor {
+    public:
+        TreeWalker& walker;
+        Handler& h;
+
+        ExpressionDispatch(TreeWalker& walker, Handler& h) : walker(walker), h(h) {}
+
+        void visit(BinaryExpr* node) override {
+            walker.exprs.push_back({node, true});
+            walker.exprs.push_back({node->right, false});
+            walker.exprs.push_back({node->left, false});
+        }
+        void visit(Identifier* node) override { h.leaf(node); }
+        void visit(NumberLiteral* node) override { h.leaf(node); }
+        void visit(Program*) override {}
+        void visit(VarDecl*) override {}
+        void visit(VarDeclAssign*) override {}
+        void visit(AssignStmt*) override {}
+        void visit(IfStmt*) override {}
+    };
+
+public:
+    // Visits `list` in source order: beginIf comes before an if's then-body,
+    // elseIf between its bodies and endIf after its else-body. Each body is
+    // read only when the walk gets to it, so beginIf and elseIf may replace
+    // the body about to be walked.
+    template <typename Handler>
+    void statements(const NodeList& list, Handler& h) {
+        StatementDispatch<Handler> dispatch(*this, h);
+        size_t base = lists.size();
+        lists.push_back({nullptr, list.begin(), list.end(), false});
+        while (lists.size() > base) {
+            ListFrame& top = lists.back();
+            if (top.next != top.end) {
+                (*top.next++)->accept(&dispatch);
+            } else if (top.node && !top.inElse) {
+                IfStmt* node = top.node;
+                h.elseIf(node);
+                top.next = node->elseBody.begin();
+                top.end = node->elseBody.end();
+                top.inElse = true;
+            } else {
+                IfStmt* node = top.node;
+                lists.pop_back();
+                if (node) h.endIf(node);
+            }
+        }
+    }
 
-    void gencode(std::ostream& out) override;
-    void gencodeL(std::ostream& out) override {}
-    void gencodeR(std::ostream& out) override {}
+    // Post-order over one expression, left operand first: binary(node) runs
+    // once both operands are done. The operands are read when the node is
+    // reached, so binary may overwrite node->left and node->right.
+    template <typename Handler>
+    void expression(Expression* root, Handler& h) {
+        ExpressionDispatch<Handler> dispatch(*this, h);
+        size_t base = exprs.size();
+        exprs.push_back({root, false});
+        while (exprs.size() > base) {
+            auto [e, expanded] = exprs.back();
+            exprs.pop_back();
+            if (expanded) {
+                h.binary(static_cast<BinaryExpr*>(e));
+            } else {
+                e->accept(&dispatch);
+            }
+        }
+    }
 };
 
 // ---------------- //
 // Print Visitor    //
 // ---------------- //
+// Children are queued on `pending` instead of visited in place, so printing
+// a deeply nested program does not recurse.
 class PrintVisitor : public ASTVisitor {
 private:
+    struct Pending {
+        ASTNode* node;          // null for a heading line
+        const char* heading;
+        int indent;
+    };
+
+    const SymbolTable& symbols;
+    std::ostream& out;
     int indent;
+    std::vector<Pending> pending;
     void printIndent();
 
+    // Queues `list` so that its first statement is printed next.
+    void queue(const NodeList& list, int depth);
+
 public:
-    PrintVisitor() : indent(0) {}
+    PrintVisitor(const SymbolTable& syms, std::ostream& out) : symbols(syms), out(out), indent(0) {}
 
     void visit(Program* node) override;
     void visit(VarDecl* node) override;
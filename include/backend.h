@@ -0,0 +1,49 @@
+// backend.h - Common interface of the code generation targets
+
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "context.h"
+#include "ir.h"
+#include "output_writer.h"
+
+struct Options;
+class ThreadPool;
+
+// A target turns the optimized IR into its output file. Everything before
+// the IR (parsing, AST passes, IR passes) is shared by all targets.
+class Backend {
+public:
+    virtual ~Backend() {}
+
+    // `outputs` marks the variables whose final values are the program's
+    // result, as Program::outputSymbols returned before the AST passes.
+    // Progress and statistics go to `log` when it is non-null. With a
+    // `pool`, runs of blocks are generated into separate buffers on it and
+    // written out together; the output is the same either way. Throws
+    // std::runtime_error on failure.
+    virtual void generate(const IrProgram& ir, const CompilationContext& ctx,
+                          const std::vector<uint8_t>& outputs,
+                          OutputWriter& out, std::ostream* log,
+                          ThreadPool* pool) = 0;
+};
+
+// Splits the blocks into runs of similar instruction counts, a few per
+// thread of `pool`, or into a single run without one. A run only starts at
+// block 0 or at a block whose `cutBefore` entry is set.
+std::vector<IrBlockRange> splitBlocks(const IrProgram& ir, ThreadPool* pool,
+                                      const std::vector<uint8_t>& cutBefore);
+
+// "abm" (the A/B/M accumulator machine) or "x86_64".
+bool isTargetName(const std::string& name);
+std::unique_ptr<Backend> makeBackend(const Options& opts);
+
+std::unique_ptr<Backend> makeAbmBackend(const Options& opts);
+std::unique_ptr<Backend> makeX86Backend();
+
+#endif
@@ -0,0 +1,51 @@
+// cache.h - Content-addressed on-disk cache of generated assembly
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+// Entries are files named by a 128-bit hash of the source bytes and of
+// everything else that affects the output (compiler build, options). A hit
+// copies the stored assembly to the requested output path. Hits refresh an
+// entry's timestamp; when the directory grows past its size limit, the least
+// recently used entries are deleted. Safe to share between batch workers.
+class CompileCache {
+private:
+    std::string dir;
+    uint64_t maxBytes;
+    std::atomic<uint64_t> totalBytes;  // valid once `sized` is set
+    std::atomic<bool> sized;
+    std::atomic<size_t> hitCount;
+    std::atomic<size_t> missCount;
+    std::atomic<size_t> evictCount;
+    std::mutex evictLock;
+
+    std::string entryPath(const std::string& key) const;
+    void measure();
+    void evict();
+
+public:
+    CompileCache(std::string dir, uint64_t maxBytes);
+
+    static std::string key(std::string_view source, std::string_view config);
+
+    // Copies the cached output for `key` to `outPath`. Returns false on a miss.
+    bool fetch(const std::string& key, const std::string& outPath);
+
+    // Records the freshly generated `outPath` under `key`.
+    void store(const std::string& key, const std::string& outPath);
+
+    size_t hits() const { return hitCount; }
+    size_t misses() const { return missCount; }
+    size_t evictions() const { return evictCount; }
+    // Bytes held by the entries. Walks the directory unless a store has
+    // already had to.
+    uint64_t sizeBytes();
+};
+
+#endif
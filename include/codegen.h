@@ -0,0 +1,29 @@
+// codegen.h - Instruction selection from IR to the A/B/M accumulator target
+
+#ifndef CODEGEN_H
+#define CODEGEN_H
+
+#include <cstdint>
+#include <vector>
+#include "context.h"
+#include "emitter.h"
+#include "ir.h"
+
+// Emits every block in layout order. The temporaries of one statement form
+// an expression tree, which is evaluated into A in Sethi-Ullman order: a
+// leaf operand is loaded straight into B, and only a node whose operands are
+// both subtrees spills one of them to a scratch address above the variables'
+// slots. Results are stored from A.
+void emitProgram(const IrProgram& ir, const CompilationContext& ctx, Emitter& out);
+
+// Blocks that are printed with a label: every source-level one, and bb_N
+// for a block that is reached other than by falling through.
+std::vector<uint8_t> labeledBlocks(const IrProgram& ir);
+
+// Emits only the blocks of `range`, as emitProgram would. The Emitter
+// forgets both registers at each label, so a range that starts with a
+// labeled block comes out exactly as it does in the whole program.
+void emitBlocks(const IrProgram& ir, const CompilationContext& ctx,
+                const std::vector<uint8_t>& labeled, const IrBlockRange& range, Emitter& out);
+
+#endif
@@ -0,0 +1,23 @@
+// const_fold.h - Constant folding and constant propagation over the AST
+
+#ifndef CONST_FOLD_H
+#define CONST_FOLD_H
+
+#include <cstddef>
+
+class Program;
+class CompilationContext;
+
+struct FoldStats {
+    size_t foldedExprs = 0;         // BinaryExpr nodes replaced by a literal
+    size_t propagatedUses = 0;      // Identifier uses replaced by a literal
+};
+
+// Rewrites `program` in place. Variables assigned a constant are tracked
+// through straight-line code and merged across both arms of every IfStmt;
+// uses of a known variable become literals and +/- over literals is computed
+// at compile time. Comparisons are never folded away, since `cmp` feeds the
+// branch that follows it.
+FoldStats foldConstants(Program& program, CompilationContext& ctx);
+
+#endif
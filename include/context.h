@@ -0,0 +1,52 @@
+// context.h - Per-compilation state: interned symbols and label numbering
+
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "arena.h"
+
+// Maps identifier text to dense integer IDs in order of first appearance.
+// Names are hashed once, while parsing; everything after the front end works
+// with the IDs only.
+class SymbolTable {
+private:
+    Arena storage;
+    std::unordered_map<std::string_view, uint32_t> ids;
+    std::vector<std::string_view> names;
+
+public:
+    SymbolTable() : storage(4096) {}
+
+    uint32_t intern(std::string_view name);
+    std::string_view name(uint32_t id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+};
+
+// Everything one compilation mutates lives here, so independent programs can
+// be compiled in the same process, one context each.
+class CompilationContext {
+private:
+    int labelCount;
+
+public:
+    SymbolTable symbols;
+    std::vector<int> slots;     // shared addresses from allocateSlots, if it ran
+
+    CompilationContext() : labelCount(0) {}
+
+    // Memory address of a variable. Address 0 is left unused.
+    int slot(uint32_t sym) const {
+        return slots.empty() ? static_cast<int>(sym) + 1 : slots[sym];
+    }
+
+    // Lowest address above every variable's slot.
+    int firstFreeSlot() const;
+
+    int newLabel() { return labelCount++; }
+};
+
+#endif
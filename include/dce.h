@@ -0,0 +1,32 @@
+// dce.h - Dead store and unreachable branch elimination over the AST
+
+#ifndef DCE_H
+#define DCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Program;
+class CompilationContext;
+
+struct DceStats {
+    size_t deadStores = 0;          // assignments whose value is never read
+    size_t deadBranches = 0;        // if arms that can never run
+    size_t emptyIfs = 0;            // ifs left with nothing in either arm
+    size_t instrsBefore = 0;        // code size estimate, before register tracking
+    size_t instrsAfter = 0;
+};
+
+// Rewrites `program` in place with a backward liveness walk; only the
+// variables marked in `outputs` are live after the last statement.
+// Expressions have no side effects, so an assignment to a variable that is
+// not live afterwards is dropped along with its expression. An if whose
+// condition compares two literals is replaced by the arm that runs, and an
+// if with both arms empty is dropped entirely. `outputs` is
+// Program::outputSymbols as taken before any pass, since dropping a
+// declaration changes what that would return.
+DceStats eliminateDeadCode(Program& program, CompilationContext& ctx,
+                           const std::vector<uint8_t>& outputs);
+
+#endif
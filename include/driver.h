@@ -0,0 +1,81 @@
+// driver.h - Command-line options and the per-file compilation pipeline
+
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "peephole.h"
+#include "phase_timer.h"
+
+class CompileCache;
+
+// Part of every compile-cache key; a rebuilt compiler never reuses entries
+// written by a different build.
+#define SLC_VERSION "slcompiler 0.1 (" __DATE__ " " __TIME__ ")"
+
+struct Options {
+    bool flatAst = false;
+    int optLevel = 1;                   // -O0: no optimization passes at all
+    bool dce = true;                    // --no-dce
+    bool peephole = true;
+    PeepholeConfig peepholeConfig;      // --peephole=rule,... and --peephole-window=N
+    std::string dumpIrAfter;            // pass name, or "lower"; empty = no IR dump
+    bool dumpTokens = false;            // --dump-tokens
+    bool dumpAst = false;               // --dump-ast
+    std::string timeReport;             // --time-report[=json]: "", "text" or "json"
+    bool batch = false;
+    unsigned jobs = 0;                  // batch or parse/codegen workers; 0 = one per hardware thread
+    std::string outDir;                 // batch outputs; empty = next to each input
+    std::string cacheDir;               // empty = no compile cache
+    uint64_t cacheMaxBytes = 256ull << 20;
+    std::string target = "abm";         // --target=abm|x86_64
+    bool emitBinary = false;            // --emit=bin: write an encoded image, not text
+    bool assemble = false;              // --assemble in.asm out.bin
+    std::string runPath;                // --run: simulate this .asm or image instead of compiling
+    uint64_t maxSteps = 100000000;
+    std::vector<std::string> inputs;    // positional arguments
+};
+
+struct CompileResult {
+    bool ok = false;
+    std::string error;
+    bool cached = false;
+    size_t sourceBytes = 0;
+    double millis = 0;
+    std::vector<PhaseStats> phases;     // read, lex, parse, each pass, codegen
+};
+
+// Returns false and fills `error` on a malformed command line. In batch mode
+// an argument of the form @file is replaced by the paths listed in that file,
+// one per line.
+bool parseOptions(int argc, char* argv[], Options& opts, std::string& error);
+
+// Everything in `opts` that can change the generated code, as a string to
+// be hashed into compile-cache keys.
+std::string codegenSignature(const Options& opts);
+
+// Compiles one source file to one assembly file. When `log` is non-null a
+// one-line summary of each pass goes to it, plus the token and AST dumps
+// asked for in `opts`. Per-phase timings are always recorded in the result. With a cache, a
+// hit copies the stored output and skips compilation entirely.
+CompileResult compileFile(const Options& opts, const std::string& inPath,
+                          const std::string& outPath, std::ostream* log,
+                          CompileCache* cache = nullptr);
+
+// Compiles every input on a work-stealing pool and prints per-file timing
+// and a throughput summary. Returns the process exit code.
+int runBatch(const Options& opts);
+
+// Loads opts.runPath, assembly text or an image, executes it on the simulator and prints cycle,
+// instruction, memory and branch counts followed by the final memory.
+// Returns the process exit code.
+int runSimulator(const Options& opts);
+
+// Encodes the assembly file inputs[0] into the image inputs[1], the same
+// bytes --emit=bin produces for that code. Returns the process exit code.
+int runAssembler(const Options& opts);
+
+#endif
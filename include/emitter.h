@@ -0,0 +1,47 @@
+// emitter.h - Instruction emission for the A/B/M accumulator target
+
+#ifndef EMITTER_H
+#define EMITTER_H
+
+#include <cstddef>
+#include "instr.h"
+
+// All code generation goes through the Emitter, which appends to an
+// in-memory InstrList so later passes can still rewrite the code before it
+// is printed. With tracking enabled it
+// remembers what the A and B registers hold, a constant and/or a copy of a
+// memory cell, and drops loads and stores that would not change anything.
+// Labels are jump targets, so both registers are forgotten at each label.
+class Emitter {
+private:
+    struct RegState {
+        bool hasConst = false;
+        int constant = 0;
+        int addr = -1;              // memory cell this register mirrors, or -1
+    };
+
+    InstrList& code;
+    bool track;
+    RegState regs[2];
+    size_t skipped;
+
+    static int index(char reg) { return reg == 'B' ? 1 : 0; }
+    void forget();
+
+public:
+    Emitter(InstrList& code, bool track = true);
+
+    void loadImm(char reg, int value);          // ldi R value
+    void load(char reg, int addr);              // mov R M addr
+    void store(int addr);                       // mov M A addr
+    void moveBA();                              // mov B A
+    void alu(Opcode op);                        // OP_ADD / OP_SUB / OP_CMP
+    void jump(Opcode op, const char* prefix, int id);   // OP_JMP / OP_JNZ to prefixN
+    void label(const char* prefix, int id);     // prefixN:
+    void halt();
+
+    size_t instructionsEmitted() const { return code.size(); }
+    size_t instructionsSkipped() const { return skipped; }
+};
+
+#endif
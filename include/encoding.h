@@ -0,0 +1,31 @@
+// encoding.h - Binary image format for the A/B/M target
+
+#ifndef ENCODING_H
+#define ENCODING_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "arena.h"
+#include "instr.h"
+
+// An image is the 4-byte magic "SLB\1", the code size in bytes as a
+// little-endian uint32, and the code. Each instruction starts with one byte:
+// the opcode in the low 4 bits and 0x10 when the register operand is B.
+// ldi, mov R M, mov M A, jmp and jnz are followed by a little-endian 32-bit
+// operand: the value, the address, or the jump target as a byte offset into
+// the code. Labels take no space.
+const uint8_t IMAGE_MAGIC[4] = {'S', 'L', 'B', 1};
+const size_t IMAGE_HEADER_SIZE = 8;
+
+// Appends the encoded program to `image`, patching every jump once its label
+// is known. Returns false and fills `error` on a jump to an undefined label.
+bool encodeProgram(const InstrList& code, std::vector<uint8_t>& image, std::string& error);
+
+bool isImage(const std::vector<uint8_t>& bytes);
+
+// Turns an image back into instructions. Jump targets become labels named
+// L<offset>, whose prefix is allocated in `labels`.
+bool decodeProgram(const std::vector<uint8_t>& image, Arena& labels, InstrList& code, std::string& error);
+
+#endif
@@ -0,0 +1,63 @@
+// flat_ast.h - Data-oriented AST: kind arrays plus 32-bit operand indices
+
+#ifndef FLAT_AST_H
+#define FLAT_AST_H
+
+#include <cstdint>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include "context.h"
+#include "ir.h"
+
+class Program;
+
+// Statements form one linear stream in source order. An if statement is
+// encoded as FS_IF, its then-statements, FS_ELSE, its else-statements and
+// FS_ENDIF, so walking the program is a single loop with no child pointers.
+enum FlatStmtKind : uint8_t {
+    FS_VAR_DECL,          // sym
+    FS_VAR_DECL_ASSIGN,   // sym, expr
+    FS_ASSIGN,            // sym, expr
+    FS_IF,                // expr (condition)
+    FS_ELSE,
+    FS_ENDIF
+};
+
+// Expressions live in a separate pool in post-order, so every operand index
+// is smaller than the index of the node that uses it.
+enum FlatExprKind : uint8_t {
+    FE_IDENT,             // lhs = symbol
+    FE_NUMBER,            // lhs = value
+    FE_ADD,               // lhs, rhs = operand indices
+    FE_SUB,
+    FE_EQ
+};
+
+class FlatAST {
+public:
+    std::vector<uint8_t> stmtKind;
+    std::vector<uint32_t> stmtSym;
+    std::vector<uint32_t> stmtExpr;
+
+    std::vector<uint8_t> exprKind;
+    std::vector<uint32_t> exprLhs;
+    std::vector<uint32_t> exprRhs;
+
+    static FlatAST build(Program* program);
+
+    void print(const SymbolTable& symbols, std::ostream& out) const;
+    void lower(CompilationContext& ctx, IrBuilder& ir) const;
+
+private:
+    // Work stacks for lowerExpr, reused across the statements of one lower().
+    struct LowerStacks {
+        std::vector<std::pair<uint32_t, bool>> pending;
+        std::vector<IrValue> values;
+    };
+
+    void printExpr(const SymbolTable& symbols, std::ostream& out, uint32_t root, int indent) const;
+    IrValue lowerExpr(IrBuilder& ir, uint32_t expr, LowerStacks& stacks) const;
+};
+
+#endif
@@ -0,0 +1,58 @@
+// instr.h - In-memory instruction list for the A/B/M target
+
+#ifndef INSTR_H
+#define INSTR_H
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "arena.h"
+#include "output_writer.h"
+
+enum Opcode : uint8_t {
+    OP_LDI,         // ldi R arg
+    OP_LOAD,        // mov R M arg
+    OP_STORE,       // mov M A arg
+    OP_MOV_BA,      // mov B A
+    OP_ADD,
+    OP_SUB,
+    OP_CMP,
+    OP_JMP,         // jmp %label arg
+    OP_JNZ,         // jnz %label arg
+    OP_LABEL,       // label arg:
+    OP_HLT,
+    OP_COUNT
+};
+
+// Labels are named by a static prefix ("else_", "endif_") plus a number, or
+// by the prefix alone when the number is negative.
+struct Instr {
+    Opcode op;
+    char reg;
+    int arg;
+    const char* label;
+
+    Instr(Opcode o, char r = 0, int a = 0, const char* l = nullptr) : op(o), reg(r), arg(a), label(l) {}
+
+    bool sameLabel(const Instr& other) const {
+        return arg == other.arg && std::strcmp(label, other.label) == 0;
+    }
+};
+
+typedef std::vector<Instr> InstrList;
+
+void printInstr(OutputWriter& out, const Instr& instr);
+void printProgram(OutputWriter& out, const InstrList& code);
+
+// Mnemonic-level name of an opcode ("ldi", "load", "store", ...).
+const char* opcodeName(Opcode op);
+
+// Reads assembly in the format printProgram writes. Label prefixes are
+// copied into `labels`, which must outlive `code`. Returns false and fills
+// `error` with the line number on malformed input.
+bool parseProgram(std::string_view text, Arena& labels, InstrList& code, std::string& error);
+
+#endif
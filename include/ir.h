@@ -0,0 +1,111 @@
+// ir.h - Three-address intermediate representation between the AST and a target
+
+#ifndef IR_H
+#define IR_H
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include "context.h"
+
+// An operand: a literal, a program variable (by symbol ID) or a compiler
+// temporary. Every temporary is assigned exactly once and read exactly once,
+// by a later instruction of the same statement.
+struct IrValue {
+    enum Kind : uint8_t { NONE, CONST, VAR, TEMP };
+
+    Kind kind = NONE;
+    int id = 0;                     // value, symbol ID or temporary number
+
+    static IrValue constant(int value) { return {CONST, value}; }
+    static IrValue var(uint32_t sym) { return {VAR, static_cast<int>(sym)}; }
+    static IrValue temp(int t) { return {TEMP, t}; }
+
+    bool operator==(const IrValue& other) const { return kind == other.kind && id == other.id; }
+};
+
+enum IrOp : uint8_t {
+    IR_COPY,                        // dst = a
+    IR_ADD,                         // dst = a + b
+    IR_SUB                          // dst = a - b
+};
+
+struct IrInstr {
+    IrOp op;
+    IrValue dst;                    // VAR or TEMP
+    IrValue a;
+    IrValue b;
+};
+
+enum IrTermKind : uint8_t {
+    IR_HALT,
+    IR_GOTO,                        // goto target
+    IR_BRANCH                       // if a == b goto target else goto other
+};
+
+struct IrTerminator {
+    IrTermKind kind = IR_HALT;
+    IrValue a;
+    IrValue b;
+    int target = -1;
+    int other = -1;
+};
+
+// Blocks are laid out in vector order; falling through goes to the next one.
+// A block created for source-level control flow keeps the label the code
+// generator has always printed for it (else_N, endif_N).
+struct IrBlock {
+    const char* labelPrefix = nullptr;
+    int labelId = 0;
+    std::vector<IrInstr> code;
+    IrTerminator term;
+};
+
+struct IrProgram {
+    std::vector<IrBlock> blocks;    // blocks[0] is the entry
+    int temps = 0;
+
+    // Drops every block whose `keep` entry is 0 and renumbers the targets of
+    // the remaining terminators. Targets must not point at dropped blocks.
+    void compact(const std::vector<uint8_t>& keep);
+};
+
+// A run of consecutive blocks [begin, end), generated as one unit, and the
+// temporaries [firstTemp, endTemp) its instructions define. A temporary is
+// only read in the block that defines it, so a code generator working on
+// the run can index its per-temporary tables by `temp - firstTemp`.
+struct IrBlockRange {
+    int begin = 0;
+    int end = 0;
+    int firstTemp = 0;
+    int endTemp = 0;
+};
+
+// Appends blocks and instructions in program order, so front ends can lower
+// straight-line code and if statements without building a CFG by hand.
+class IrBuilder {
+private:
+    IrProgram& ir;
+    int current;
+
+public:
+    IrBuilder(IrProgram& program);
+
+    int newBlock(const char* labelPrefix = nullptr, int labelId = 0);
+    int currentBlock() const { return current; }
+
+    IrValue newTemp() { return IrValue::temp(ir.temps++); }
+    void emit(IrOp op, IrValue dst, IrValue a, IrValue b = IrValue());
+
+    // dst = value. A temporary just computed by the current block's last
+    // instruction is renamed to `dst` instead of being copied.
+    void assign(IrValue dst, IrValue value);
+
+    // Terminators are set after the fact, once the target blocks exist.
+    void setBranch(int block, IrValue a, IrValue b, int target, int other);
+    void setJump(int block, int target);
+};
+
+void printIr(const IrProgram& ir, const SymbolTable& symbols, std::ostream& out);
+
+#endif
@@ -3,55 +3,71 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
+#include "lexer_scan.h"
 
 
 enum TokenType {
-    TOK_INT,       
-    TOK_IF,        
-    TOK_ELSE,       
-    TOK_ID,         
-    TOK_NUM,       
-    TOK_ASSIGN,    
-    TOK_PLUS,       
-    TOK_MINUS,      
-    TOK_EQ,        
-    TOK_LBRACE,     
-    TOK_RBRACE,     
-    TOK_LPAREN,    
-    TOK_RPAREN,     
-    TOK_SEMI,     
-    TOK_EOF,        
-    TOK_UNKNOWN     
+    TOK_INT,
+    TOK_IF,
+    TOK_ELSE,
+    TOK_ID,
+    TOK_NUM,
+    TOK_ASSIGN,
+    TOK_PLUS,
+    TOK_MINUS,
+    TOK_EQ,
+    TOK_LBRACE,
+    TOK_RBRACE,
+    TOK_LPAREN,
+    TOK_RPAREN,
+    TOK_SEMI,
+    TOK_EOF,
+    TOK_UNKNOWN
 };
 
+// Tokens never own their text: `text` points into the Lexer's source buffer,
+// so the Lexer must outlive every Token it hands out. TOK_NUM tokens carry the
+// converted integer in `value`; a literal above INT_MAX makes next() throw
+// std::runtime_error.
 struct Token {
     TokenType type;
-    std::string value;
-    
-    Token() : type(TOK_UNKNOWN), value("") {}
-    Token(TokenType t, std::string v) : type(t), value(v) {}
+    std::string_view text;
+    int value;
+
+    Token() : type(TOK_UNKNOWN), text(), value(0) {}
+    Token(TokenType t, std::string_view s, int v = 0) : type(t), text(s), value(v) {}
 };
 
 
 class Lexer {
 private:
-    std::string input;              
-    size_t pos;                     
-    std::vector<Token> tokens;      
-    
-  
-    void skipWhitespace();          
-    void readIdentifier();    
-    void readNumber();              
-    bool isAtEnd();                
-    
+    std::string_view input;
+    size_t begin;
+    size_t pos;
+    const ScanKernels* scan;        // chosen once, when the Lexer is created
+    std::vector<Token> tokens;
+
+
+    void skipWhitespace();
+    Token readIdentifier();
+    Token readNumber();
+    bool isAtEnd();
+    Token makeToken(TokenType type, size_t start, size_t len, int value = 0);
+
 public:
-    Lexer(std::string code);        
-    void tokenize();               
-    void printTokens();             
-    std::vector<Token>& getTokens() { return tokens; }  
+    // `code` must outlive the Lexer and its tokens. Lexing starts at offset
+    // `begin`; error line numbers still count from the start of `code`.
+    Lexer(std::string_view code, size_t begin = 0);
+    Token next();                   // pull one token; TOK_EOF repeats at the end
+    void tokenize();                // materialize every token into getTokens()
+    void reset();                   // rewind to `begin`
+    void printTokens(std::ostream& out) const;
+    std::vector<Token>& getTokens() { return tokens; }
+    std::string_view source() const { return input; }
 };
 
 #endif
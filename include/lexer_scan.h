@@ -0,0 +1,62 @@
+// lexer_scan.h - Character classes and vectorized run scanning for the lexer
+
+#ifndef LEXER_SCAN_H
+#define LEXER_SCAN_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Classes are bits so one table lookup answers any of the lexer's questions.
+// They follow the "C" locale: bytes above 0x7F belong to no class.
+enum CharClass : uint8_t {
+    CC_SPACE = 1,       // ' ' \t \n \v \f \r
+    CC_ALPHA = 2,       // letters: may start an identifier
+    CC_DIGIT = 4,
+    CC_IDENT = 8,       // letters, digits and '_': may continue an identifier
+    CC_DELIM = 16,      // { } ;  the bytes that end a top-level statement
+};
+
+constexpr std::array<uint8_t, 256> makeCharClasses() {
+    std::array<uint8_t, 256> table{};
+    for (int c = 0; c < 256; c++) {
+        uint8_t cls = 0;
+        if (c == ' ' || (c >= '\t' && c <= '\r')) cls |= CC_SPACE;
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) cls |= CC_ALPHA | CC_IDENT;
+        if (c >= '0' && c <= '9') cls |= CC_DIGIT | CC_IDENT;
+        if (c == '_') cls |= CC_IDENT;
+        if (c == '{' || c == '}' || c == ';') cls |= CC_DELIM;
+        table[c] = cls;
+    }
+    return table;
+}
+
+inline constexpr std::array<uint8_t, 256> charClasses = makeCharClasses();
+
+inline bool hasClass(char c, uint8_t cls) {
+    return (charClasses[static_cast<unsigned char>(c)] & cls) != 0;
+}
+
+// Each skip kernel returns the first position in [pos, end) whose byte is
+// not in the kernel's class, or `end`; findDelim returns the first one whose
+// byte is in CC_DELIM. Vector kernels test 16 or 32 bytes per step and never
+// read at or past `end`, so they are safe on an exact-size mmap.
+struct ScanKernels {
+    const char* name;
+    size_t (*skipSpace)(const char* text, size_t pos, size_t end);
+    size_t (*skipIdent)(const char* text, size_t pos, size_t end);
+    size_t (*skipDigits)(const char* text, size_t pos, size_t end);
+    size_t (*findDelim)(const char* text, size_t pos, size_t end);
+};
+
+// The kernels every new Lexer uses. The first call picks the widest set the
+// CPU supports: avx2, then sse2, then the table-driven scalar loop.
+const ScanKernels& scanKernels();
+
+// Overrides the choice: "auto", "scalar", "sse2" or "avx2". Returns false for
+// an unknown name or one this CPU or build cannot run. Call before any
+// compilation starts; the choice is not synchronized with running lexers.
+bool selectScanKernels(std::string_view name);
+
+#endif
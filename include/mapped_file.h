@@ -0,0 +1,34 @@
+// mapped_file.h - Read-only memory mapping of a source file
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// A whole file as a string_view. Regular files are mapped with mmap, so the
+// lexer reads straight from the page cache without a copy. Files that cannot
+// be mapped (pipes, empty files) are read into an owned buffer instead. The
+// view stays valid until the MappedFile is destroyed.
+class MappedFile {
+private:
+    const char* base;
+    size_t length;
+    bool mapped;
+    std::string contents;       // fallback storage when mapping is not possible
+
+public:
+    MappedFile() : base(nullptr), length(0), mapped(false) {}
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns false if the file cannot be opened or read.
+    bool open(const std::string& path);
+
+    std::string_view view() const { return std::string_view(base, length); }
+    size_t size() const { return length; }
+};
+
+#endif
@@ -0,0 +1,91 @@
+// output_writer.h - Buffered writer for generated code
+
+#ifndef OUTPUT_WRITER_H
+#define OUTPUT_WRITER_H
+
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Formats into one large buffer and hands it to write(2) only when the buffer
+// fills or the file is closed, so a typical output file costs one or two
+// system calls instead of one flush per instruction. There is no locale or
+// stream state: integers are formatted with std::to_chars.
+//
+// A writer that is never opened collects its output in memory instead,
+// growing the buffer as needed, so code for one part of a program can be
+// formatted on its own thread and written out later with writeParts.
+class OutputWriter {
+private:
+    int fd;
+    std::unique_ptr<char[]> buf;
+    size_t capacity;
+    size_t used;
+    size_t writeCalls;
+    uint64_t written;
+    bool failed;
+
+    void flush();
+    void writeAll(const char* data, size_t size);
+    void grow(size_t needed);
+
+public:
+    explicit OutputWriter(size_t capacity = 1 << 20);
+    ~OutputWriter();
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    // Creates or truncates `path`. Returns false if it cannot be opened.
+    bool open(const std::string& path);
+
+    // Flushes and closes the file. Returns false if any write failed.
+    bool close();
+
+    void write(const char* data, size_t size) {
+        if (size > capacity - used) {
+            flush();
+            if (size > capacity - used) {
+                writeAll(data, size);
+                return;
+            }
+        }
+        std::memcpy(buf.get() + used, data, size);
+        used += size;
+    }
+
+    OutputWriter& operator<<(std::string_view text) {
+        write(text.data(), text.size());
+        return *this;
+    }
+
+    OutputWriter& operator<<(char c) {
+        if (used == capacity) flush();
+        buf[used++] = c;
+        return *this;
+    }
+
+    template <std::integral T>
+    OutputWriter& operator<<(T value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        write(digits, result.ptr - digits);
+        return *this;
+    }
+
+    // Writes what is buffered followed by each of `parts`, with a single
+    // writev(2) unless the kernel takes less than everything at once.
+    void writeParts(const std::string_view* parts, size_t count);
+
+    // The output collected so far by a writer that was never opened.
+    std::string_view text() const { return std::string_view(buf.get(), used); }
+
+    size_t systemCalls() const { return writeCalls; }
+    uint64_t bytesWritten() const { return written + used; }
+};
+
+#endif
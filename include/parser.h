@@ -1,36 +1,107 @@
+#ifndef PARSER_H
 #define PARSER_H
 
 #include "lexer.h"
 #include "ast.h"
 #include <memory>
+#include <string_view>
+#include <vector>
+
+class ThreadPool;
 
 class Parser {
 private:
-    std::vector<Token> tokens;      
-    int current;                    
-    
-    
-    bool isEnd();                   
-    bool match(TokenType type);     
-    void expect(TokenType type);    
-    void advance();                 
-    
-    
-    std::unique_ptr<ASTNode> parseStatement();       
-    std::unique_ptr<VarDecl> parseVarDecl();    
-    std::unique_ptr<VarDeclAssign> parseVarDeclAssign(); 
-    std::unique_ptr<AssignStmt> parseAssignment();  
-    std::unique_ptr<IfStmt> parseIfStmt();         
-    
-    
-    std::unique_ptr<Expression> parseExpression();   
-    std::unique_ptr<Expression> parseComparison();   
-    std::unique_ptr<Expression> parseAddition();     
-    std::unique_ptr<Expression> parsePrimary();      
-    
+    // Tokens are pulled either from a Lexer on demand (streaming) or from an
+    // already materialized token vector. Either way the parser only looks at
+    // a small window: the current token plus what "int ID =" needs to decide
+    // between a declaration and a declaration with assignment.
+    static const size_t LOOKAHEAD = 4;
+
+    Lexer* lexer;
+    const Token* tokens;
+    size_t tokenCount;
+    size_t nextIndex;
+
+    Token window[LOOKAHEAD];
+    size_t head;
+    size_t buffered;
+
+    // Nodes go into the arena of the Program being built. Statement lists are
+    // collected on a shared scratch stack and copied into the arena as one
+    // contiguous array once their block closes.
+    Arena* arena;
+    std::vector<ASTNode*> scratch;
+
+    // Blocks and parentheses that are still open. Both are tracked here
+    // instead of on the call stack, so nesting depth is limited only by
+    // memory.
+    struct OpenBlock {
+        IfStmt* node;
+        size_t mark;            // start of this body on `scratch`
+        bool inElse;
+    };
+    struct OpenExpr {
+        Expression* sum;        // left operand of the pending +/-, null if none
+        std::string_view sumOp;
+        Expression* cmpLeft;    // left operand of '==' once it has been seen
+        std::string_view cmpOp;
+    };
+    std::vector<OpenBlock> blocks;
+    std::vector<OpenExpr> exprs;
+
+    CompilationContext& ctx;
+
+
+    Token fetch();
+    const Token& peek(size_t k = 0);
+    bool isEnd();
+    bool match(TokenType type);
+    void expect(TokenType type);
+    void advance();
+    std::string_view takeText();
+    uint32_t takeSymbol();
+    NodeList finishList(size_t mark);
+
+
+    bool closeBlock();
+    ASTNode* parseStatement();
+    VarDecl* parseVarDecl();
+    VarDeclAssign* parseVarDeclAssign();
+    AssignStmt* parseAssignment();
+    IfStmt* parseIfHead();
+
+
+    Expression* parseExpression();
+    Expression* parsePrimary();
+    Expression* finishExpr();
+
 public:
-    Parser(std::vector<Token> toks);                
-    std::unique_ptr<Program> parse(); 
+    Parser(Lexer& lex, CompilationContext& ctx);                         // streaming
+    Parser(const std::vector<Token>& toks, CompilationContext& ctx);     // materialized, not copied
+    std::unique_ptr<Program> parse();
 };
 
+// Sources smaller than this are parsed serially; splitting them costs more
+// than it saves.
+const size_t PARALLEL_PARSE_MIN_BYTES = 1 << 20;
+
+// A byte range of the source holding only whole top-level statements.
+struct SourceChunk {
+    size_t begin;
+    size_t end;
+};
+
+// Cuts `source` into at most `chunks` consecutive ranges of at least
+// `minBytes` each, except for the last. A cut only follows a ';' or '}' at
+// brace depth 0, and never a '}' followed by `else`. Every cut therefore
+// falls between two top-level statements, and parsing the ranges one after
+// another gives the same statements as parsing all of `source`.
+std::vector<SourceChunk> splitTopLevel(std::string_view source, size_t chunks, size_t minBytes);
+
+// Parses `source` in chunks on `pool`, each with its own arena and symbol
+// table, and merges them in source order. The result, symbol IDs included,
+// is the same as Parser::parse() would build; on a syntax error the one
+// thrown is the first in the source.
+std::unique_ptr<Program> parseParallel(std::string_view source, CompilationContext& ctx, ThreadPool& pool);
+
 #endif
@@ -0,0 +1,52 @@
+// pass_manager.h - Ordered IR passes with timing and IR dumps
+
+#ifndef PASS_MANAGER_H
+#define PASS_MANAGER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ir.h"
+
+class PhaseTimer;
+
+// A pass rewrites the IR in place and returns true if it changed anything.
+typedef bool (*IrPass)(IrProgram& ir);
+
+class PassManager {
+private:
+    struct Entry {
+        const char* name;
+        IrPass run;
+        double millis = 0;
+        bool changed = false;
+    };
+    std::vector<Entry> passes;
+
+public:
+    void add(const char* name, IrPass pass);
+
+    // Runs every registered pass once, in order. When `dumpAfter` names a
+    // pass, or is "lower" for the IR as it came from the front end, the IR at
+    // that point is printed to `dump`. With a timer, each pass is recorded
+    // as its own phase.
+    void run(IrProgram& ir, const SymbolTable& symbols,
+             const std::string& dumpAfter, std::ostream& dump,
+             PhaseTimer* timer = nullptr);
+
+    // One line: each pass with its time and whether it changed the IR.
+    void report(std::ostream& out) const;
+};
+
+// Standard pipeline; -O0 registers nothing.
+void addStandardPasses(PassManager& passes, int optLevel);
+
+// Names accepted by --dump-ir-after: "lower" and every standard pass.
+bool isIrPassName(const std::string& name);
+
+// Standard passes
+bool foldBranches(IrProgram& ir);       // constant conditions become gotos
+bool threadJumps(IrProgram& ir);        // skip blocks that only jump onwards
+bool removeUnreachable(IrProgram& ir);  // drop blocks no path reaches
+
+#endif
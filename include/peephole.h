@@ -0,0 +1,42 @@
+// peephole.h - Window-based cleanup of the emitted instruction list
+
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include <cstddef>
+#include <string>
+#include "instr.h"
+
+enum PeepholeRule {
+    PH_STORE_RELOAD,        // mov M A n; mov A M n        -> drop the reload
+    PH_REDUNDANT_LOAD,      // load of a value the register already holds
+    PH_DUPLICATE_STORE,     // mov M A n again while A is unchanged
+    PH_JUMP_TO_NEXT,        // jmp/jnz %L where only labels separate it from L:
+    PH_RULE_COUNT
+};
+
+struct PeepholeConfig {
+    bool enabled[PH_RULE_COUNT] = {true, true, true, true};
+    size_t window = 8;              // how far back the rules may look
+};
+
+struct PeepholeStats {
+    size_t hits[PH_RULE_COUNT] = {};
+    size_t before = 0;
+    size_t after = 0;
+};
+
+// Name used on the command line and in the hit report.
+const char* peepholeRuleName(int rule);
+
+// Enables exactly the comma-separated rules in `list`. Returns false and
+// fills `error` on an unknown name.
+bool parsePeepholeRules(const std::string& list, PeepholeConfig& config, std::string& error);
+
+// Rewrites `code` in place. Instructions are copied to the output one at a
+// time and the rules only ever inspect the last `window` instructions of
+// it, so a removal that exposes another match is picked up straight away
+// and the pass is linear in the length of the program.
+PeepholeStats runPeephole(InstrList& code, const PeepholeConfig& config);
+
+#endif
@@ -0,0 +1,53 @@
+// phase_timer.h - Per-phase wall time, allocation and peak RSS accounting
+
+#ifndef PHASE_TIMER_H
+#define PHASE_TIMER_H
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct PhaseStats {
+    std::string name;
+    double millis = 0;
+    uint64_t allocations = 0;       // operator new calls made during the phase
+    uint64_t allocatedBytes = 0;
+    long peakRssKb = 0;             // process peak RSS when the phase ended
+};
+
+// Records consecutive phases of one compilation. begin() closes the phase
+// that is still open, so a pipeline only has to name each step as it starts.
+// Allocations are counted per thread, which keeps the numbers of one file
+// exact while a batch compiles others on the same pool.
+class PhaseTimer {
+private:
+    std::vector<PhaseStats> list;
+    bool open = false;
+    std::chrono::steady_clock::time_point start;
+    uint64_t allocsAtStart = 0;
+    uint64_t bytesAtStart = 0;
+
+public:
+    void begin(std::string name);
+    void end();
+    const std::vector<PhaseStats>& phases() const { return list; }
+};
+
+// Number of operator new calls and bytes requested on this thread so far.
+uint64_t threadAllocations();
+uint64_t threadAllocatedBytes();
+
+// Peak resident set size of the process, in KiB.
+long peakRssKb();
+
+// Adds `phases` into `totals`, matching phases by name; peak RSS takes the
+// maximum. Phases not yet in `totals` are appended in order.
+void accumulatePhases(std::vector<PhaseStats>& totals, const std::vector<PhaseStats>& phases);
+
+// A table with one line per phase and a total, or a single JSON object
+// {"phases":[{"name":...,"ms":...,"allocs":...,"alloc_bytes":...,"peak_rss_kb":...},...]}.
+void printTimeReport(std::ostream& out, const std::vector<PhaseStats>& phases, bool json);
+
+#endif
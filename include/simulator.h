@@ -0,0 +1,53 @@
+// simulator.h - Cycle-counting interpreter for the A/B/M target
+
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "instr.h"
+
+// Cost model, in cycles: register-only instructions (ldi, mov B A, add, sub,
+// cmp, hlt) take 1, a memory load or store takes 2, jmp takes 2 and jnz
+// takes 2 when taken and 1 when it falls through. Labels are free.
+struct SimStats {
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t byOpcode[OP_COUNT] = {};
+    uint64_t memReads = 0;
+    uint64_t memWrites = 0;
+    uint64_t branches = 0;          // jnz executed
+    uint64_t branchesTaken = 0;
+    uint64_t jumps = 0;             // jmp executed
+};
+
+class Simulator {
+private:
+    const InstrList& code;
+    std::vector<int> target;        // instruction index -> resolved jump target
+    std::vector<uint8_t> touched;
+
+public:
+    int regA = 0;
+    int regB = 0;
+    bool zero = false;              // set by cmp when A == B
+    std::vector<int> memory;        // every address the program names, zeroed
+    SimStats stats;
+
+    Simulator(const InstrList& code);
+
+    // Resolves labels up front. Returns false and fills `error` on a jump
+    // to a label that is not defined or a negative address.
+    bool link(std::string& error);
+
+    // Runs until hlt, the end of the code, or `maxSteps` instructions.
+    // Returns false and fills `error` in the last case.
+    bool run(uint64_t maxSteps, std::string& error);
+
+    // Counters and the final contents of every address the program used.
+    void report(std::ostream& out) const;
+};
+
+#endif
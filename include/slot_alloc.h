@@ -0,0 +1,29 @@
+// slot_alloc.h - Liveness analysis and memory-slot sharing for variables
+
+#ifndef SLOT_ALLOC_H
+#define SLOT_ALLOC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Program;
+class CompilationContext;
+
+struct SlotStats {
+    size_t variables = 0;           // symbols that are read or written
+    size_t slotsBefore = 0;         // one address per symbol
+    size_t slotsAfter = 0;
+};
+
+// Gives every variable a live interval over the statements in source order
+// and fills ctx.slots so that variables whose intervals do not overlap share
+// a memory address. A variable that may be read before it is assigned is
+// live from the start of the program, so its address is never handed to
+// anything else before that read. The variables marked in `outputs` are
+// read after the last statement, by the same rule: they stay live past it,
+// and from the start of the program if some path leaves them unassigned.
+SlotStats allocateSlots(Program& program, CompilationContext& ctx,
+                        const std::vector<uint8_t>& outputs);
+
+#endif
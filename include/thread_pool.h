@@ -0,0 +1,59 @@
+// thread_pool.h - Work-stealing thread pool for batch and parallel compilation
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Every worker owns a deque. Tasks submitted from a worker go to that
+// worker's own deque and are popped LIFO; idle workers steal FIFO from the
+// other deques, so long-running tasks spread across all cores. Tasks submitted
+// from outside the pool go to a shared queue that is drained in FIFO order.
+class ThreadPool {
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    Queue injected;
+    std::vector<std::thread> workers;
+
+    std::mutex stateLock;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::atomic<size_t> queued;
+    std::atomic<size_t> pending;
+    std::exception_ptr failure;
+    bool stopping;
+
+    bool tryPop(unsigned self, std::function<void()>& task);
+    void run(unsigned self);
+    void finish(std::exception_ptr error);
+
+public:
+    // threads == 0 uses one worker per hardware thread.
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+
+    // Blocks until every submitted task has finished. Rethrows the first
+    // exception a task let escape, if any.
+    void wait();
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+};
+
+#endif
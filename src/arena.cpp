@@ -0,0 +1,39 @@
+#include "arena.h"
+
+
+Arena::Arena(size_t blockSize)
+    : cur(nullptr), end(nullptr), blockSize(blockSize), used(0), reserved(0), objects(0) {
+}
+
+void* Arena::allocateSlow(size_t size, size_t align) {
+    // Oversized requests get a block of their own so the current block keeps
+    // serving small nodes.
+    size_t need = size + align;
+    if (need > blockSize / 4) {
+        blocks.push_back(std::make_unique_for_overwrite<char[]>(need));
+        reserved += need;
+        char* base = blocks.back().get();
+        char* p = base + (align - reinterpret_cast<size_t>(base) % align) % align;
+        used += size;
+        return p;
+    }
+
+    blocks.push_back(std::make_unique_for_overwrite<char[]>(blockSize));
+    reserved += blockSize;
+    cur = blocks.back().get();
+    end = cur + blockSize;
+    return allocate(size, align);
+}
+
+void Arena::absorb(Arena& other) {
+    for (auto& block : other.blocks) {
+        blocks.push_back(std::move(block));
+    }
+    used += other.used;
+    reserved += other.reserved;
+    objects += other.objects;
+
+    other.blocks.clear();
+    other.cur = other.end = nullptr;
+    other.used = other.reserved = other.objects = 0;
+}
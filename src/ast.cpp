@@ -2,177 +2,220 @@
 
 #include "ast.h"
 #include <iostream>
-
-
-std::unordered_map<std::string, int> Identifier::mem_map;
-int Identifier::mem_loc = 1;
+#include <stdexcept>
 
 
 void PrintVisitor::printIndent() {
     for (int i = 0; i < indent; i++) {
-        std::cout << "  ";
+        out << "  ";
     }
 }
 
 
+void PrintVisitor::queue(const NodeList& list, int depth) {
+    for (size_t i = list.size(); i > 0; i--) {
+        pending.push_back({list[i - 1], nullptr, depth});
+    }
+}
+
 void PrintVisitor::visit(Program* node) {
-    std::cout << "Program:" << std::endl;
-    indent++;
-    for (auto& stmt : node->statements) {
-        stmt->accept(this);
+    out << "Program:\n";
+    queue(node->statements, 1);
+    while (!pending.empty()) {
+        Pending next = pending.back();
+        pending.pop_back();
+        indent = next.indent;
+        if (next.node) {
+            next.node->accept(this);
+        } else {
+            printIndent();
+            out << next.heading << "\n";
+        }
     }
-    indent--;
+    indent = 0;
 }
 
 void PrintVisitor::visit(VarDecl* node) {
     printIndent();
-    std::cout << "VarDecl: " << node->name << std::endl;
+    out << "VarDecl: " << symbols.name(node->sym) << "\n";
 }
 
 void PrintVisitor::visit(VarDeclAssign* node) {
     printIndent();
-    std::cout << "VarDeclAssign: " << node->name << " = " << std::endl;
-    indent++;
-    node->expr->accept(this);
-    indent--;
+    out << "VarDeclAssign: " << symbols.name(node->sym) << " = \n";
+    pending.push_back({node->expr, nullptr, indent + 1});
 }
 
 void PrintVisitor::visit(AssignStmt* node) {
     printIndent();
-    std::cout << "Assignment: " << node->varName << " = " << std::endl;
-    indent++;
-    node->expr->accept(this);
-    indent--;
+    out << "Assignment: " << symbols.name(node->sym) << " = \n";
+    pending.push_back({node->expr, nullptr, indent + 1});
 }
 
 void PrintVisitor::visit(BinaryExpr* node) {
     printIndent();
-    std::cout << "BinaryExpr: " << node->op << std::endl;
-    indent++;
-    node->left->accept(this);
-    node->right->accept(this);
-    indent--;
+    out << "BinaryExpr: " << node->op << "\n";
+    pending.push_back({node->right, nullptr, indent + 1});
+    pending.push_back({node->left, nullptr, indent + 1});
 }
 
+// Queued last to first: condition, then-body and else-body, each under its
+// heading.
 void PrintVisitor::visit(IfStmt* node) {
     printIndent();
-    std::cout << "IfStmt:" << std::endl;
-    indent++;
-
-    printIndent();
-    std::cout << "Condition:" << std::endl;
-    indent++;
-    node->condition->accept(this);
-    indent--;
-
-    printIndent();
-    std::cout << "Then Body:" << std::endl;
-    indent++;
-    for (auto& stmt : node->thenBody) stmt->accept(this);
-    indent--;
-
+    out << "IfStmt:\n";
     if (!node->elseBody.empty()) {
-        printIndent();
-        std::cout << "Else Body:" << std::endl;
-        indent++;
-        for (auto& stmt : node->elseBody) stmt->accept(this);
-        indent--;
+        queue(node->elseBody, indent + 2);
+        pending.push_back({nullptr, "Else Body:", indent + 1});
     }
-
-    indent--;
+    queue(node->thenBody, indent + 2);
+    pending.push_back({nullptr, "Then Body:", indent + 1});
+    pending.push_back({node->condition, nullptr, indent + 2});
+    pending.push_back({nullptr, "Condition:", indent + 1});
 }
 
 void PrintVisitor::visit(Identifier* node) {
     printIndent();
-    std::cout << "Identifier: " << node->name << std::endl;
+    out << "Identifier: " << symbols.name(node->sym) << "\n";
 }
 
 void PrintVisitor::visit(NumberLiteral* node) {
     printIndent();
-    std::cout << "Number: " << node->value << std::endl;
-}
-
-Identifier::Identifier(std::string n) : name(n) {
-    if (mem_map.find(name) == mem_map.end()) {
-        mem_map[name] = mem_loc++;
+    out << "Number: " << node->value << "\n";
+}
+
+namespace {
+
+// bit 0: declared at the top level, bit 1: declared inside an if
+struct DeclarationMarker {
+    std::vector<uint8_t>& declared;
+    int depth = 0;
+
+    void statement(VarDecl* node) { declared[node->sym] |= depth ? 2 : 1; }
+    void statement(VarDeclAssign* node) { declared[node->sym] |= depth ? 2 : 1; }
+    void statement(AssignStmt*) {}
+    void beginIf(IfStmt*) { depth++; }
+    void elseIf(IfStmt*) {}
+    void endIf(IfStmt*) { depth--; }
+};
+
+// Lowers statements as the walker reaches them. Expressions are lowered
+// post-order onto an operand stack, so no part of lowering recurses.
+class Lowerer {
+private:
+    // The condition block branches to a then block laid out right after it,
+    // an else_N block and finally the endif_N block both arms jump to. A
+    // condition other than a comparison is true when it is non-zero.
+    struct OpenIf {
+        int id;
+        int head;
+        IrValue lhs, rhs;
+        bool isEq;
+        int thenBlock, thenEnd, elseBlock;
+    };
+
+    CompilationContext& ctx;
+    IrBuilder& ir;
+    TreeWalker walker;
+    std::vector<OpenIf> openIfs;
+    std::vector<IrValue> operands;
+
+public:
+    Lowerer(CompilationContext& ctx, IrBuilder& ir) : ctx(ctx), ir(ir) {}
+
+    void run(const NodeList& statements) { walker.statements(statements, *this); }
+
+    IrValue expression(Expression* e) {
+        walker.expression(e, *this);
+        IrValue value = operands.back();
+        operands.pop_back();
+        return value;
     }
-    loc = mem_map[name];
-}
 
-void Program::gencode(std::ostream& out) {
-    for (auto& stmt : statements) {
-        stmt->gencode(out);
+    void leaf(Identifier* node) { operands.push_back(IrValue::var(node->sym)); }
+    void leaf(NumberLiteral* node) { operands.push_back(IrValue::constant(node->value)); }
+
+    void binary(BinaryExpr* node) {
+        IrOp irOp;
+        if (node->op == "+") {
+            irOp = IR_ADD;
+        } else if (node->op == "-") {
+            irOp = IR_SUB;
+        } else if (node->op == "==") {
+            throw std::runtime_error("'==' is only supported as an if condition");
+        } else {
+            throw std::runtime_error("Unsupported operator in lowering: " + std::string(node->op));
+        }
+
+        IrValue rhs = operands.back();
+        operands.pop_back();
+        IrValue lhs = operands.back();
+        IrValue result = ir.newTemp();
+        ir.emit(irOp, result, lhs, rhs);
+        operands.back() = result;
     }
-}
 
-void Identifier::gencode(std::ostream& out) {
-    out << "mov M A " << mem_map[name] << std::endl;
-}
-void Identifier::gencodeL(std::ostream& out) {
-    out << "mov A M " << mem_map[name] << std::endl;
-}
-void Identifier::gencodeR(std::ostream& out) {
-    out << "mov B M " << mem_map[name] << std::endl;
-}
-
-void NumberLiteral::gencode(std::ostream& out) {
-    out << "ldi A " << value << std::endl;
-}
-void NumberLiteral::gencodeL(std::ostream& out) {
-    out << "ldi A " << value << std::endl;
-}
-void NumberLiteral::gencodeR(std::ostream& out) {
-    out << "ldi B " << value << std::endl;
-}
+    // Storage is implied by the symbol; nothing to emit.
+    void statement(VarDecl*) {}
 
-void BinaryExpr::gencode(std::ostream& out) {
-    left->gencodeL(out);
-    right->gencodeR(out);
-
-    if (op == "==") {
-        out << "cmp" << std::endl;
-    } else if (op == "+") {
-        out << "add" << std::endl;
-    } else if (op == "-") {
-        out << "sub" << std::endl;
-    } else {
-        throw std::runtime_error("Unsupported operator in gencode: " + op);
+    void statement(VarDeclAssign* node) {
+        ir.assign(IrValue::var(node->sym), expression(node->expr));
     }
-}
 
-void VarDecl::gencode(std::ostream& out) {
-    if (Identifier::mem_map.find(name) == Identifier::mem_map.end()) {
-        Identifier::mem_map[name] = Identifier::mem_loc++;
+    void statement(AssignStmt* node) {
+        ir.assign(IrValue::var(node->sym), expression(node->expr));
     }
-  
-}
 
-void VarDeclAssign::gencode(std::ostream& out) {
-    if (Identifier::mem_map.find(name) == Identifier::mem_map.end()) {
-        Identifier::mem_map[name] = Identifier::mem_loc++;
+    void beginIf(IfStmt* node) {
+        OpenIf open;
+        open.id = ctx.newLabel();
+        auto* cmp = dynamic_cast<BinaryExpr*>(node->condition);
+        open.isEq = cmp && cmp->op == "==";
+        if (open.isEq) {
+            open.lhs = expression(cmp->left);
+            open.rhs = expression(cmp->right);
+        } else {
+            open.lhs = expression(node->condition);
+            open.rhs = IrValue::constant(0);
+        }
+        open.head = ir.currentBlock();
+        open.thenBlock = ir.newBlock();
+        openIfs.push_back(open);
     }
-    expr->gencode(out);
-    out << "mov M A " << Identifier::mem_map[name] << std::endl;
-}
 
-void AssignStmt::gencode(std::ostream& out) {
-    expr->gencode(out);
-    out << "mov M A " << Identifier::mem_map[varName] << std::endl;
-}
-
-void IfStmt::gencode(std::ostream& out) {
-    static int labelCount = 0;
-    int id = labelCount++;
-
-    condition->gencode(out);
-    out << "jnz %else_" << id << std::endl;
+    void elseIf(IfStmt*) {
+        OpenIf& open = openIfs.back();
+        open.thenEnd = ir.currentBlock();
+        open.elseBlock = ir.newBlock("else_", open.id);
+    }
 
-    for (auto& stmt : thenBody) stmt->gencode(out);
-    out << "jmp %endif_" << id << std::endl;
+    void endIf(IfStmt*) {
+        OpenIf& open = openIfs.back();
+        int elseEnd = ir.currentBlock();
+        int join = ir.newBlock("endif_", open.id);
+        if (open.isEq) {
+            ir.setBranch(open.head, open.lhs, open.rhs, open.thenBlock, open.elseBlock);
+        } else {
+            ir.setBranch(open.head, open.lhs, open.rhs, open.elseBlock, open.thenBlock);
+        }
+        ir.setJump(open.thenEnd, join);
+        ir.setJump(elseEnd, join);
+        openIfs.pop_back();
+    }
+};
 
-    out << "else_" << id << ":" << std::endl;
-    for (auto& stmt : elseBody) stmt->gencode(out);
+}
 
-    out << "endif_" << id << ":" << std::endl;
+std::vector<uint8_t> Program::outputSymbols(size_t symbols) const {
+    std::vector<uint8_t> declared(symbols, 0);
+    DeclarationMarker marker{declared};
+    TreeWalker().statements(statements, marker);
+    for (uint8_t& d : declared) {
+        d = (d & 1) || d == 0;
+    }
+    return declared;
 }
 
+void Program::lower(CompilationContext& ctx, IrBuilder& ir) {
+    Lowerer(ctx, ir).run(statements);
+}
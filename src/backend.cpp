@@ -0,0 +1,220 @@
+#include "backend.h"
+#include "codegen.h"
+#include "driver.h"
+#include "encoding.h"
+#include "peephole.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <stdexcept>
+
+
+namespace {
+
+// Parts of a program smaller than this are not worth a task of their own.
+const size_t MIN_PART_INSTRS = 16 * 1024;
+
+// Instruction selection through the register-tracking Emitter, the
+// peephole pass, then text or a binary image.
+class AbmBackend : public Backend {
+private:
+    const Options& opts;
+
+    // A run of blocks taken through selection and the peephole pass on its own.
+    struct Part {
+        IrBlockRange blocks;
+        InstrList code;
+        size_t emitted = 0;
+        size_t skipped = 0;
+        PeepholeStats peep;
+    };
+
+    bool peephole() const {
+        return opts.optLevel >= 1 && opts.peephole;
+    }
+
+    void generatePart(const IrProgram& ir, const CompilationContext& ctx,
+                      const std::vector<uint8_t>& labeled, Part& part) {
+        part.code.clear();
+        Emitter emitter(part.code, opts.optLevel >= 1);
+        emitBlocks(ir, ctx, labeled, part.blocks, emitter);
+        part.emitted = emitter.instructionsEmitted();
+        part.skipped = emitter.instructionsSkipped();
+        if (peephole()) part.peep = runPeephole(part.code, opts.peepholeConfig);
+    }
+
+    // Only jump-to-next looks back past a label, so a part can be handled on
+    // its own as long as the one before it does not end in a jump that may
+    // target one of its leading labels, or in a label that such a search
+    // would skip over. A pair that fails this is redone as one part.
+    void joinParts(const IrProgram& ir, const CompilationContext& ctx,
+                   const std::vector<uint8_t>& labeled, std::vector<Part>& parts) {
+        if (!peephole() || !opts.peepholeConfig.enabled[PH_JUMP_TO_NEXT]) return;
+        for (size_t i = 1; i < parts.size();) {
+            const InstrList& prev = parts[i - 1].code;
+            Opcode tail = prev.empty() ? OP_LABEL : prev.back().op;
+            if (tail != OP_JMP && tail != OP_JNZ && tail != OP_LABEL) {
+                i++;
+                continue;
+            }
+            IrBlockRange& joined = parts[i - 1].blocks;
+            const IrBlockRange& next = parts[i].blocks;
+            joined.end = next.end;
+            if (joined.firstTemp == joined.endTemp) {
+                joined.firstTemp = next.firstTemp;
+                joined.endTemp = next.endTemp;
+            } else if (next.firstTemp != next.endTemp) {
+                joined.firstTemp = std::min(joined.firstTemp, next.firstTemp);
+                joined.endTemp = std::max(joined.endTemp, next.endTemp);
+            }
+            parts.erase(parts.begin() + i);
+            generatePart(ir, ctx, labeled, parts[i - 1]);
+        }
+    }
+
+public:
+    AbmBackend(const Options& opts) : opts(opts) {}
+
+    void generate(const IrProgram& ir, const CompilationContext& ctx,
+                  const std::vector<uint8_t>& outputs,
+                  OutputWriter& out, std::ostream* log, ThreadPool* pool) override {
+        // Registers are forgotten at a label, so a part may start at any
+        // labeled block. Cutting only after a block that ends without a jump
+        // keeps joinParts from having anything to redo.
+        std::vector<uint8_t> labeled = labeledBlocks(ir);
+        std::vector<uint8_t> cutBefore(ir.blocks.size(), 0);
+        for (size_t i = 1; i < ir.blocks.size(); i++) {
+            const IrBlock& prev = ir.blocks[i - 1];
+            bool fallsThrough = prev.term.kind == IR_GOTO && prev.term.target == static_cast<int>(i);
+            cutBefore[i] = labeled[i] && (prev.term.kind == IR_HALT || (fallsThrough && !prev.code.empty()));
+        }
+
+        std::vector<Part> parts;
+        for (const IrBlockRange& range : splitBlocks(ir, pool, cutBefore)) {
+            parts.emplace_back();
+            parts.back().blocks = range;
+        }
+        if (parts.size() > 1) {
+            for (Part& part : parts) {
+                pool->submit([&, p = &part] { generatePart(ir, ctx, labeled, *p); });
+            }
+            pool->wait();
+            joinParts(ir, ctx, labeled, parts);
+        } else {
+            generatePart(ir, ctx, labeled, parts[0]);
+        }
+
+        size_t emitted = 0;
+        size_t skipped = 0;
+        PeepholeStats peep;
+        for (const Part& part : parts) {
+            emitted += part.emitted;
+            skipped += part.skipped;
+            peep.before += part.peep.before;
+            peep.after += part.peep.after;
+            for (int rule = 0; rule < PH_RULE_COUNT; rule++) peep.hits[rule] += part.peep.hits[rule];
+        }
+        if (log && opts.optLevel >= 1) {
+            *log << "Register tracking: " << emitted << " instructions emitted, "
+                 << skipped << " redundant loads/stores removed\n";
+        }
+        if (log && peephole()) {
+            *log << "Peephole: " << peep.before << " -> " << peep.after << " instructions";
+            for (int rule = 0; rule < PH_RULE_COUNT; rule++) {
+                *log << (rule ? ", " : " (") << peepholeRuleName(rule) << " " << peep.hits[rule];
+            }
+            *log << ")\n";
+        }
+
+        if (opts.emitBinary) {
+            InstrList& code = parts[0].code;
+            for (size_t i = 1; i < parts.size(); i++) {
+                code.insert(code.end(), parts[i].code.begin(), parts[i].code.end());
+            }
+            std::vector<uint8_t> image;
+            std::string error;
+            if (!encodeProgram(code, image, error)) {
+                throw std::runtime_error(error);
+            }
+            out.write(reinterpret_cast<const char*>(image.data()), image.size());
+            if (log) *log << "Binary image: " << image.size() << " bytes\n";
+        } else if (parts.size() == 1) {
+            printProgram(out, parts[0].code);
+        } else {
+            // Each part is formatted into a buffer of its own, and the
+            // buffers go out behind the header in one write.
+            std::vector<std::unique_ptr<OutputWriter>> texts(parts.size());
+            for (size_t i = 0; i < parts.size(); i++) {
+                pool->submit([&, i] {
+                    texts[i] = std::make_unique<OutputWriter>(16 * parts[i].code.size() + 64);
+                    for (const Instr& instr : parts[i].code) printInstr(*texts[i], instr);
+                });
+            }
+            pool->wait();
+            std::vector<std::string_view> views;
+            for (const auto& text : texts) views.push_back(text->text());
+            out << ".text\n";
+            out.writeParts(views.data(), views.size());
+        }
+    }
+};
+
+}
+
+
+std::vector<IrBlockRange> splitBlocks(const IrProgram& ir, ThreadPool* pool,
+                                      const std::vector<uint8_t>& cutBefore) {
+    size_t total = 0;
+    for (const IrBlock& block : ir.blocks) total += block.code.size() + 1;
+    size_t target = SIZE_MAX;
+    if (pool) target = std::max(total / (4 * pool->size()) + 1, MIN_PART_INSTRS);
+
+    std::vector<IrBlockRange> ranges;
+    IrBlockRange range;
+    range.firstTemp = INT_MAX;
+    range.endTemp = INT_MIN;
+    size_t weight = 0;
+    auto finish = [&](int end) {
+        range.end = end;
+        if (range.firstTemp > range.endTemp) range.firstTemp = range.endTemp = 0;
+        ranges.push_back(range);
+        range = IrBlockRange();
+        range.begin = end;
+        range.firstTemp = INT_MAX;
+        range.endTemp = INT_MIN;
+        weight = 0;
+    };
+
+    int count = static_cast<int>(ir.blocks.size());
+    for (int i = 0; i < count; i++) {
+        if (i > range.begin && weight >= target && cutBefore[i]) finish(i);
+        const IrBlock& block = ir.blocks[i];
+        weight += block.code.size() + 1;
+        for (const IrInstr& instr : block.code) {
+            if (instr.dst.kind != IrValue::TEMP) continue;
+            range.firstTemp = std::min(range.firstTemp, instr.dst.id);
+            range.endTemp = std::max(range.endTemp, instr.dst.id + 1);
+        }
+    }
+    finish(count);
+    return ranges;
+}
+
+bool isTargetName(const std::string& name) {
+    return name == "abm" || name == "x86_64";
+}
+
+std::unique_ptr<Backend> makeBackend(const Options& opts) {
+    if (opts.target == "x86_64") {
+        return makeX86Backend();
+    }
+    if (opts.target == "abm") {
+        return makeAbmBackend(opts);
+    }
+    throw std::runtime_error("Unknown target " + opts.target);
+}
+
+std::unique_ptr<Backend> makeAbmBackend(const Options& opts) {
+    return std::make_unique<AbmBackend>(opts);
+}
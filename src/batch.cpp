@@ -0,0 +1,96 @@
+#include "driver.h"
+#include "thread_pool.h"
+#include "cache.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+
+
+namespace {
+
+std::string batchOutputPath(const Options& opts, const std::string& input) {
+    std::filesystem::path out(input);
+    out.replace_extension(opts.emitBinary ? ".bin" : opts.target == "x86_64" ? ".s" : ".asm");
+    if (!opts.outDir.empty()) {
+        out = std::filesystem::path(opts.outDir) / out.filename();
+    }
+    return out.string();
+}
+
+}
+
+
+int runBatch(const Options& opts) {
+    if (opts.inputs.empty()) {
+        std::cerr << "Error: --batch needs at least one source file\n";
+        return 1;
+    }
+    if (!opts.outDir.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(opts.outDir, ec);
+    }
+
+    std::vector<std::string> outputs;
+    for (auto& input : opts.inputs) {
+        outputs.push_back(batchOutputPath(opts, input));
+    }
+
+    std::unique_ptr<CompileCache> cache;
+    if (!opts.cacheDir.empty()) {
+        cache = std::make_unique<CompileCache>(opts.cacheDir, opts.cacheMaxBytes);
+    }
+
+    // Every task writes only its own slot, so no locking is needed.
+    std::vector<CompileResult> results(opts.inputs.size());
+    auto start = std::chrono::steady_clock::now();
+    unsigned threads;
+    {
+        ThreadPool pool(opts.jobs);
+        threads = pool.size();
+        for (size_t i = 0; i < opts.inputs.size(); i++) {
+            pool.submit([&, i] {
+                results[i] = compileFile(opts, opts.inputs[i], outputs[i], nullptr, cache.get());
+            });
+        }
+        pool.wait();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t failed = 0;
+    size_t totalBytes = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        const CompileResult& r = results[i];
+        totalBytes += r.sourceBytes;
+        if (r.ok) {
+            std::printf("[%zu/%zu] %s -> %s  %.2f ms  %zu bytes%s\n", i + 1, results.size(),
+                        opts.inputs[i].c_str(), outputs[i].c_str(), r.millis, r.sourceBytes,
+                        r.cached ? "  (cached)" : "");
+        } else {
+            failed++;
+            std::printf("[%zu/%zu] %s FAILED: %s\n", i + 1, results.size(),
+                        opts.inputs[i].c_str(), r.error.c_str());
+        }
+    }
+
+    double mb = totalBytes / (1024.0 * 1024.0);
+    std::printf("Batch: %zu files (%zu failed), %.2f MB in %.3f s on %u threads: %.1f files/s, %.2f MB/s\n",
+                results.size(), failed, mb, seconds, threads,
+                seconds > 0 ? results.size() / seconds : 0.0,
+                seconds > 0 ? mb / seconds : 0.0);
+    if (!opts.timeReport.empty()) {
+        // Summed over all files; each file's phases ran on a single thread.
+        std::vector<PhaseStats> totals;
+        for (const CompileResult& r : results) {
+            accumulatePhases(totals, r.phases);
+        }
+        std::fflush(stdout);
+        printTimeReport(std::cerr, totals, opts.timeReport == "json");
+    }
+    if (cache) {
+        std::printf("Cache: %zu hits, %zu misses, %zu evicted, %.2f MB in %s\n",
+                    cache->hits(), cache->misses(), cache->evictions(),
+                    cache->sizeBytes() / (1024.0 * 1024.0), opts.cacheDir.c_str());
+    }
+    return failed == 0 ? 0 : 1;
+}
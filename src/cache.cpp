@@ -0,0 +1,166 @@
+#include "cache.h"
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+
+namespace {
+
+// FNV-1a, 128-bit variant
+__uint128_t fnv1a128(__uint128_t hash, std::string_view bytes) {
+    const __uint128_t prime = (static_cast<__uint128_t>(0x0000000001000000ull) << 64) | 0x000000000000013Bull;
+    for (unsigned char c : bytes) {
+        hash ^= c;
+        hash *= prime;
+    }
+    return hash;
+}
+
+std::string toHex(__uint128_t value) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out(32, '0');
+    for (int i = 31; i >= 0; i--) {
+        out[i] = digits[static_cast<unsigned>(value & 0xf)];
+        value >>= 4;
+    }
+    return out;
+}
+
+// Entries end in ".asm"; anything else is a store still in progress.
+bool isEntry(const fs::directory_entry& file, std::error_code& ec) {
+    return file.is_regular_file(ec) && file.path().extension() == ".asm";
+}
+
+}
+
+
+CompileCache::CompileCache(std::string d, uint64_t limit)
+    : dir(std::move(d)), maxBytes(limit), totalBytes(0), sized(false),
+      hitCount(0), missCount(0), evictCount(0) {
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+}
+
+std::string CompileCache::key(std::string_view source, std::string_view config) {
+    const __uint128_t basis = (static_cast<__uint128_t>(0x6c62272e07bb0142ull) << 64) | 0x62b821756295c58dull;
+    __uint128_t hash = fnv1a128(basis, config);
+    hash = fnv1a128(hash, std::string_view("\0", 1));
+    hash = fnv1a128(hash, source);
+    return toHex(hash);
+}
+
+std::string CompileCache::entryPath(const std::string& key) const {
+    // Two-character fan-out keeps directories small on large caches.
+    return (fs::path(dir) / key.substr(0, 2) / (key.substr(2) + ".asm")).string();
+}
+
+bool CompileCache::fetch(const std::string& key, const std::string& outPath) {
+    std::string entry = entryPath(key);
+    std::error_code ec;
+    if (!fs::copy_file(entry, outPath, fs::copy_options::overwrite_existing, ec)) {
+        missCount++;
+        return false;
+    }
+    fs::last_write_time(entry, fs::file_time_type::clock::now(), ec);
+    hitCount++;
+    return true;
+}
+
+void CompileCache::store(const std::string& key, const std::string& outPath) {
+    std::string entry = entryPath(key);
+    std::error_code ec;
+    fs::create_directories(fs::path(entry).parent_path(), ec);
+
+    // Copy under a unique temporary name and rename, so concurrent readers
+    // never see a partially written entry.
+    std::string tmp = entry + ".tmp" + std::to_string(getpid()) + "-" +
+                      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    if (!fs::copy_file(outPath, tmp, fs::copy_options::overwrite_existing, ec)) {
+        return;
+    }
+    uint64_t size = fs::file_size(tmp, ec);
+
+    // Only a store can push the cache over its limit, so the directory is
+    // first measured here rather than when it is opened; a run of hits never
+    // walks it. Measuring before the rename keeps this entry from being
+    // counted twice.
+    if (!sized) {
+        measure();
+    }
+
+    // Storing a key again replaces its entry, whose size is already counted.
+    std::error_code missing;
+    uint64_t replaced = fs::file_size(entry, missing);
+    if (missing) replaced = 0;
+
+    fs::rename(tmp, entry, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return;
+    }
+
+    if (size < replaced) {
+        totalBytes -= replaced - size;
+    } else if ((totalBytes += size - replaced) > maxBytes) {
+        evict();
+    }
+}
+
+void CompileCache::measure() {
+    std::lock_guard<std::mutex> guard(evictLock);
+    if (sized) {
+        return;
+    }
+    uint64_t size = 0;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(dir, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (isEntry(*it, ec)) size += it->file_size(ec);
+    }
+    totalBytes = size;
+    sized = true;
+}
+
+uint64_t CompileCache::sizeBytes() {
+    if (!sized) {
+        measure();
+    }
+    return totalBytes;
+}
+
+void CompileCache::evict() {
+    std::lock_guard<std::mutex> guard(evictLock);
+    if (totalBytes <= maxBytes) {
+        return;
+    }
+
+    struct Entry {
+        fs::path path;
+        fs::file_time_type used;
+        uint64_t size;
+    };
+    std::vector<Entry> entries;
+    uint64_t size = 0;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(dir, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (!isEntry(*it, ec)) continue;
+        Entry e{it->path(), it->last_write_time(ec), it->file_size(ec)};
+        size += e.size;
+        entries.push_back(std::move(e));
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.used < b.used; });
+
+    // Trim to 90% of the limit so the next few stores don't evict again.
+    uint64_t target = maxBytes - maxBytes / 10;
+    for (auto& e : entries) {
+        if (size <= target) break;
+        if (fs::remove(e.path, ec)) {
+            size -= e.size;
+            evictCount++;
+        }
+    }
+    totalBytes = size;
+}
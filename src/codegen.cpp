@@ -0,0 +1,225 @@
+#include "codegen.h"
+#include <algorithm>
+
+
+namespace {
+
+class BlockEmitter {
+public:
+    const IrProgram& ir;
+    const CompilationContext& ctx;
+    Emitter& out;
+
+    int spillBase;
+    int spillDepth = 0;
+    const IrBlock* block = nullptr;
+    int tempBase;                   // first temporary of the emitted range
+    std::vector<int> defIndex;      // temporary -> defining instruction in `block`
+    std::vector<int> need;          // temporary -> registers its tree needs
+
+    BlockEmitter(const IrProgram& ir, const CompilationContext& ctx, const IrBlockRange& range,
+                 Emitter& out)
+        : ir(ir), ctx(ctx), out(out), spillBase(ctx.firstFreeSlot()), tempBase(range.firstTemp),
+          defIndex(range.endTemp - range.firstTemp, -1), need(range.endTemp - range.firstTemp, 0) {}
+
+    void jumpTo(Opcode op, int target) {
+        const IrBlock& b = ir.blocks[target];
+        if (b.labelPrefix) {
+            out.jump(op, b.labelPrefix, b.labelId);
+        } else {
+            out.jump(op, "bb_", target);
+        }
+    }
+
+    static bool isLeaf(const IrValue& value) {
+        return value.kind != IrValue::TEMP;
+    }
+
+    int needOf(const IrValue& value) const {
+        return isLeaf(value) ? 0 : need[value.id - tempBase];
+    }
+
+    // Classic Sethi-Ullman number, with a right-hand leaf costing nothing
+    // because it is loaded straight into B.
+    int label(const IrInstr& instr) const {
+        if (instr.op == IR_COPY) return std::max(1, needOf(instr.a));
+        int l = std::max(1, needOf(instr.a));
+        int r = needOf(instr.b);
+        return l == r ? l + 1 : std::max(l, r);
+    }
+
+    void leaf(char reg, const IrValue& value) {
+        if (value.kind == IrValue::CONST) {
+            out.loadImm(reg, value.id);
+        } else {
+            out.load(reg, ctx.slot(static_cast<uint32_t>(value.id)));
+        }
+    }
+
+    // A tree is emitted by popping steps off `steps` rather than by
+    // recursing, so an arbitrarily deep tree needs no native stack. Steps
+    // are pushed in reverse, so they run in the order they are listed.
+    struct Step {
+        enum Kind { EVAL, LEAF_A, LEAF_B, MOVE_BA, SPILL, RELOAD, ALU };
+        Kind kind;
+        Opcode op;
+        IrValue value;
+    };
+    std::vector<Step> steps;
+
+    void push(Step::Kind kind, const IrValue& value = IrValue(), Opcode op = OP_HLT) {
+        steps.push_back({kind, op, value});
+    }
+
+    void run() {
+        while (!steps.empty()) {
+            Step step = steps.back();
+            steps.pop_back();
+            switch (step.kind) {
+                case Step::EVAL:
+                    if (isLeaf(step.value)) {
+                        leaf('A', step.value);
+                    } else {
+                        pushInstruction(block->code[defIndex[step.value.id - tempBase]]);
+                    }
+                    break;
+                case Step::LEAF_A:
+                    leaf('A', step.value);
+                    break;
+                case Step::LEAF_B:
+                    leaf('B', step.value);
+                    break;
+                case Step::MOVE_BA:
+                    out.moveBA();
+                    break;
+                case Step::SPILL:
+                    out.store(spillBase + spillDepth++);
+                    break;
+                case Step::RELOAD:
+                    out.load('B', spillBase + --spillDepth);
+                    break;
+                case Step::ALU:
+                    out.alu(step.op);
+                    break;
+            }
+        }
+    }
+
+    // Leaves the value `instr` computes in A.
+    void pushInstruction(const IrInstr& instr) {
+        if (instr.op == IR_COPY) {
+            push(Step::EVAL, instr.a);
+        } else {
+            pushOperation(instr.op == IR_ADD ? OP_ADD : OP_SUB, instr.a, instr.b);
+        }
+    }
+
+    // A = lhs op rhs. add and cmp are commutative, sub is not.
+    void pushOperation(Opcode op, const IrValue& lhs, const IrValue& rhs) {
+        bool commutative = op != OP_SUB;
+
+        push(Step::ALU, IrValue(), op);
+        if (isLeaf(rhs)) {
+            push(Step::LEAF_B, rhs);
+            push(Step::EVAL, lhs);
+        } else if (isLeaf(lhs) && commutative) {
+            push(Step::LEAF_B, lhs);
+            push(Step::EVAL, rhs);
+        } else if (isLeaf(lhs)) {
+            push(Step::LEAF_A, lhs);
+            push(Step::MOVE_BA);
+            push(Step::EVAL, rhs);
+        } else {
+            // Both operands are subtrees: B is clobbered while evaluating
+            // either one, so the first result has to go to memory. Go
+            // deepest-first when the order is free, so fewer spill slots are
+            // held at once.
+            const IrValue* first = &rhs;
+            const IrValue* second = &lhs;
+            if (commutative && needOf(lhs) > needOf(rhs)) std::swap(first, second);
+
+            push(Step::RELOAD);
+            push(Step::EVAL, *second);
+            push(Step::SPILL);
+            push(Step::EVAL, *first);
+        }
+    }
+
+    void instruction(const IrInstr& instr) {
+        pushInstruction(instr);
+        run();
+    }
+
+    void operation(Opcode op, const IrValue& lhs, const IrValue& rhs) {
+        pushOperation(op, lhs, rhs);
+        run();
+    }
+
+    void emitBlock(int index) {
+        block = &ir.blocks[index];
+        for (size_t k = 0; k < block->code.size(); k++) {
+            const IrInstr& instr = block->code[k];
+            if (instr.dst.kind == IrValue::TEMP) {
+                // Generated where it is used, as part of its tree.
+                defIndex[instr.dst.id - tempBase] = static_cast<int>(k);
+                need[instr.dst.id - tempBase] = label(instr);
+                continue;
+            }
+            instruction(instr);
+            out.store(ctx.slot(static_cast<uint32_t>(instr.dst.id)));
+        }
+
+        const IrTerminator& term = block->term;
+        int next = index + 1;
+        switch (term.kind) {
+            case IR_HALT:
+                out.halt();
+                break;
+            case IR_GOTO:
+                if (term.target != next) jumpTo(OP_JMP, term.target);
+                break;
+            case IR_BRANCH:
+                // jnz is taken when the operands differ.
+                operation(OP_CMP, term.a, term.b);
+                jumpTo(OP_JNZ, term.other);
+                if (term.target != next) jumpTo(OP_JMP, term.target);
+                break;
+        }
+    }
+};
+
+}
+
+
+void emitProgram(const IrProgram& ir, const CompilationContext& ctx, Emitter& out) {
+    IrBlockRange all;
+    all.end = static_cast<int>(ir.blocks.size());
+    all.endTemp = ir.temps;
+    emitBlocks(ir, ctx, labeledBlocks(ir), all, out);
+}
+
+std::vector<uint8_t> labeledBlocks(const IrProgram& ir) {
+    std::vector<uint8_t> labeled(ir.blocks.size(), 0);
+    for (size_t i = 0; i < ir.blocks.size(); i++) {
+        const IrBlock& block = ir.blocks[i];
+        const IrTerminator& term = block.term;
+        if (block.labelPrefix) labeled[i] = 1;
+        if (term.kind == IR_BRANCH) labeled[term.other] = 1;
+        if (term.kind != IR_HALT && term.target != static_cast<int>(i + 1)) labeled[term.target] = 1;
+    }
+    return labeled;
+}
+
+void emitBlocks(const IrProgram& ir, const CompilationContext& ctx,
+                const std::vector<uint8_t>& labeled, const IrBlockRange& range, Emitter& out) {
+    BlockEmitter emitter(ir, ctx, range, out);
+    for (int i = range.begin; i < range.end; i++) {
+        const IrBlock& block = ir.blocks[i];
+        if (block.labelPrefix) {
+            out.label(block.labelPrefix, block.labelId);
+        } else if (labeled[i]) {
+            out.label("bb_", i);
+        }
+        emitter.emitBlock(i);
+    }
+}
@@ -0,0 +1,237 @@
+#include "const_fold.h"
+#include "ast.h"
+#include <algorithm>
+#include <climits>
+#include <utility>
+#include <vector>
+
+
+namespace {
+
+// Known constant value per symbol. Every change is logged so an if-arm can
+// be rolled back and its effects compared with the other arm's, at a cost
+// proportional to what the arms assign rather than to the number of symbols.
+class ConstEnv {
+public:
+    struct Change {
+        uint32_t sym;
+        bool known;
+        int value;
+    };
+
+private:
+    std::vector<uint8_t> known;
+    std::vector<int> values;
+    std::vector<Change> log;
+
+public:
+    ConstEnv(size_t symbols) : known(symbols, 0), values(symbols, 0) {}
+
+    bool get(uint32_t sym, int& value) const {
+        if (!known[sym]) return false;
+        value = values[sym];
+        return true;
+    }
+
+    void set(uint32_t sym, bool isKnown, int value) {
+        log.push_back({sym, known[sym] != 0, values[sym]});
+        known[sym] = isKnown;
+        values[sym] = value;
+    }
+
+    size_t mark() const { return log.size(); }
+
+    // Undoes everything after `m` and returns the final state of each symbol
+    // touched since then, sorted by symbol.
+    std::vector<Change> rollback(size_t m) {
+        std::vector<Change> after;
+        for (size_t i = m; i < log.size(); i++) {
+            uint32_t sym = log[i].sym;
+            after.push_back({sym, known[sym] != 0, values[sym]});
+        }
+        std::sort(after.begin(), after.end(), [](const Change& a, const Change& b) { return a.sym < b.sym; });
+        after.erase(std::unique(after.begin(), after.end(),
+                                [](const Change& a, const Change& b) { return a.sym == b.sym; }),
+                    after.end());
+        while (log.size() > m) {
+            Change& c = log.back();
+            known[c.sym] = c.known;
+            values[c.sym] = c.value;
+            log.pop_back();
+        }
+        return after;
+    }
+};
+
+// Statements are reached through a TreeWalker and expressions are folded
+// post-order, each node replaced by the result on top of `results`.
+class ConstantFolder {
+public:
+    struct OpenIf {
+        size_t mark;
+        int decided;        // 1: then-arm always runs, -1: else-arm always runs
+        std::vector<ConstEnv::Change> thenState;
+    };
+
+    Arena& arena;
+    ConstEnv env;
+    FoldStats stats;
+    TreeWalker walker;
+    std::vector<OpenIf> openIfs;
+    std::vector<Expression*> results;
+
+    ConstantFolder(Program& program, CompilationContext& ctx)
+        : arena(program.arena), env(ctx.symbols.size()) {}
+
+    Expression* fold(Expression* e) {
+        walker.expression(e, *this);
+        Expression* folded = results.back();
+        results.pop_back();
+        return folded;
+    }
+
+    static bool literal(Expression* e, int& value) {
+        if (auto* num = dynamic_cast<NumberLiteral*>(e)) {
+            value = num->value;
+            return true;
+        }
+        return false;
+    }
+
+    void assign(uint32_t sym, Expression* expr) {
+        int value;
+        bool isKnown = literal(expr, value);
+        env.set(sym, isKnown, isKnown ? value : 0);
+    }
+
+    void statement(VarDecl*) {
+        // Declaring again does not touch the variable's storage.
+    }
+
+    void statement(VarDeclAssign* node) {
+        node->expr = fold(node->expr);
+        assign(node->sym, node->expr);
+    }
+
+    void statement(AssignStmt* node) {
+        node->expr = fold(node->expr);
+        assign(node->sym, node->expr);
+    }
+
+    void beginIf(IfStmt* node) {
+        node->condition = fold(node->condition);
+
+        // For "x == k" the then-arm only runs when x holds k. A comparison of
+        // two literals decides which arm runs at all.
+        auto* cmp = dynamic_cast<BinaryExpr*>(node->condition);
+        bool isEq = cmp && cmp->op == "==";
+        int lhs, rhs;
+        int decided = 0;
+        if (isEq && literal(cmp->left, lhs) && literal(cmp->right, rhs)) {
+            decided = lhs == rhs ? 1 : -1;
+        }
+
+        openIfs.push_back({env.mark(), decided, {}});
+        if (isEq) {
+            auto* id = dynamic_cast<Identifier*>(cmp->left);
+            if (id && literal(cmp->right, rhs)) env.set(id->sym, true, rhs);
+        }
+    }
+
+    void elseIf(IfStmt*) {
+        OpenIf& open = openIfs.back();
+        open.thenState = env.rollback(open.mark);
+    }
+
+    void endIf(IfStmt*) {
+        OpenIf open = std::move(openIfs.back());
+        openIfs.pop_back();
+        auto elseState = env.rollback(open.mark);
+        const auto& thenState = open.thenState;
+
+        if (open.decided == 1) {
+            for (auto& c : thenState) env.set(c.sym, c.known, c.value);
+            return;
+        }
+        if (open.decided == -1) {
+            for (auto& c : elseState) env.set(c.sym, c.known, c.value);
+            return;
+        }
+
+        // A symbol stays known after the if only when both arms leave it
+        // holding the same constant. Symbols neither arm touched keep their
+        // current state; walk the two sorted change lists side by side.
+        size_t t = 0, e = 0;
+        while (t < thenState.size() || e < elseState.size()) {
+            uint32_t sym;
+            if (e == elseState.size() || (t < thenState.size() && thenState[t].sym < elseState[e].sym)) {
+                sym = thenState[t].sym;
+            } else {
+                sym = elseState[e].sym;
+            }
+
+            int before = 0;
+            bool knownBefore = env.get(sym, before);
+            bool knownThen = knownBefore, knownElse = knownBefore;
+            int valueThen = before, valueElse = before;
+            if (t < thenState.size() && thenState[t].sym == sym) {
+                knownThen = thenState[t].known;
+                valueThen = thenState[t].value;
+                t++;
+            }
+            if (e < elseState.size() && elseState[e].sym == sym) {
+                knownElse = elseState[e].known;
+                valueElse = elseState[e].value;
+                e++;
+            }
+            bool same = knownThen && knownElse && valueThen == valueElse;
+            env.set(sym, same, same ? valueThen : 0);
+        }
+    }
+
+    void binary(BinaryExpr* node) {
+        node->right = results.back();
+        results.pop_back();
+        node->left = results.back();
+        results.pop_back();
+
+        int lhs, rhs;
+        if (node->op == "==" || !literal(node->left, lhs) || !literal(node->right, rhs)) {
+            results.push_back(node);
+            return;
+        }
+
+        // Source literals are never negative and may be up to INT_MAX, so only
+        // fold results the language could have spelled directly.
+        long long value = node->op == "+" ? (long long)lhs + rhs : (long long)lhs - rhs;
+        if (value < 0 || value > INT_MAX) {
+            results.push_back(node);
+            return;
+        }
+        stats.foldedExprs++;
+        results.push_back(arena.make<NumberLiteral>(static_cast<int>(value)));
+    }
+
+    void leaf(Identifier* node) {
+        int value;
+        if (env.get(node->sym, value)) {
+            stats.propagatedUses++;
+            results.push_back(arena.make<NumberLiteral>(value));
+        } else {
+            results.push_back(node);
+        }
+    }
+
+    void leaf(NumberLiteral* node) {
+        results.push_back(node);
+    }
+};
+
+}
+
+
+FoldStats foldConstants(Program& program, CompilationContext& ctx) {
+    ConstantFolder folder(program, ctx);
+    folder.walker.statements(program.statements, folder);
+    return folder.stats;
+}
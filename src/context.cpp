@@ -0,0 +1,23 @@
+#include "context.h"
+#include <algorithm>
+
+
+uint32_t SymbolTable::intern(std::string_view name) {
+    auto it = ids.find(name);
+    if (it != ids.end()) {
+        return it->second;
+    }
+
+    uint32_t id = static_cast<uint32_t>(names.size());
+    std::string_view stored = storage.copyString(name);
+    names.push_back(stored);
+    ids.emplace(stored, id);
+    return id;
+}
+
+int CompilationContext::firstFreeSlot() const {
+    if (slots.empty()) {
+        return static_cast<int>(symbols.size()) + 1;
+    }
+    return *std::max_element(slots.begin(), slots.end()) + 1;
+}
@@ -0,0 +1,257 @@
+#include "dce.h"
+#include "ast.h"
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+
+namespace {
+
+// Liveness per symbol, with every change logged so both arms of an if can
+// start from the state after it.
+class LiveSet {
+public:
+    struct Change {
+        uint32_t sym;
+        bool live;
+    };
+
+private:
+    std::vector<uint8_t> live;
+    std::vector<Change> log;
+
+public:
+    LiveSet(size_t symbols) : live(symbols, 0) {}
+
+    bool get(uint32_t sym) const { return live[sym] != 0; }
+
+    void set(uint32_t sym, bool isLive) {
+        if (get(sym) == isLive) return;
+        log.push_back({sym, get(sym)});
+        live[sym] = isLive;
+    }
+
+    size_t mark() const { return log.size(); }
+
+    // Undoes everything after `m` and returns the final state of each symbol
+    // touched since then, sorted by symbol.
+    std::vector<Change> rollback(size_t m) {
+        std::vector<Change> after;
+        for (size_t i = m; i < log.size(); i++) {
+            after.push_back({log[i].sym, get(log[i].sym)});
+        }
+        std::sort(after.begin(), after.end(), [](const Change& a, const Change& b) { return a.sym < b.sym; });
+        after.erase(std::unique(after.begin(), after.end(),
+                                [](const Change& a, const Change& b) { return a.sym == b.sym; }),
+                    after.end());
+        while (log.size() > m) {
+            live[log.back().sym] = log.back().live;
+            log.pop_back();
+        }
+        return after;
+    }
+
+    // Sets each symbol either arm touched to live-in-either-arm. A symbol only
+    // one arm touched keeps the current state on the other.
+    void mergeArms(const std::vector<Change>& a, const std::vector<Change>& b) {
+        size_t i = 0, j = 0;
+        while (i < a.size() || j < b.size()) {
+            uint32_t sym;
+            if (j == b.size() || (i < a.size() && a[i].sym < b[j].sym)) {
+                sym = a[i].sym;
+            } else {
+                sym = b[j].sym;
+            }
+            bool liveA = get(sym), liveB = get(sym);
+            if (i < a.size() && a[i].sym == sym) liveA = a[i++].live;
+            if (j < b.size() && b[j].sym == sym) liveB = b[j++].live;
+            set(sym, liveA || liveB);
+        }
+    }
+};
+
+// Instructions the code generator emits for a statement list, not counting
+// labels: one per expression node, one per store, jnz and jmp per if.
+struct CodeSize {
+    size_t size = 0;
+    TreeWalker walker;
+
+    void statement(VarDecl*) {}
+    void statement(VarDeclAssign* node) { walker.expression(node->expr, *this); size++; }
+    void statement(AssignStmt* node) { walker.expression(node->expr, *this); size++; }
+    void beginIf(IfStmt* node) { walker.expression(node->condition, *this); size += 2; }
+    void elseIf(IfStmt*) {}
+    void endIf(IfStmt*) {}
+    void leaf(Identifier*) { size++; }
+    void leaf(NumberLiteral*) { size++; }
+    void binary(BinaryExpr*) { size++; }
+};
+
+size_t codeSize(const NodeList& list) {
+    CodeSize counter;
+    counter.walker.statements(list, counter);
+    return counter.size;
+}
+
+// Sweeps statement lists back to front. Instead of recursing into an if,
+// the sweep pushes a Frame for the arm it enters and resumes the enclosing
+// list once that arm is done.
+class DeadCodeEliminator {
+public:
+    struct Frame {
+        enum Kind { ROOT, TAKEN, THEN, ELSE };
+        Kind kind;
+        IfStmt* node;
+        NodeList list;
+        size_t next;                    // statements of `list` not yet swept
+        size_t scratchMark;
+        size_t liveMark;
+        NodeList thenBody;              // ELSE only: the then-arm as swept
+        std::vector<LiveSet::Change> thenLive;
+    };
+
+    Arena& arena;
+    LiveSet live;
+    DceStats stats;
+    std::vector<ASTNode*> scratch;      // kept statements, in reverse order
+    std::vector<Frame> frames;
+    TreeWalker walker;
+
+    DeadCodeEliminator(Program& program, CompilationContext& ctx, const std::vector<uint8_t>& outputs)
+        : arena(program.arena), live(ctx.symbols.size()) {
+        for (uint32_t sym = 0; sym < outputs.size(); sym++) {
+            if (outputs[sym]) live.set(sym, true);
+        }
+    }
+
+    // Expression walks only add uses.
+    void leaf(Identifier* node) { live.set(node->sym, true); }
+    void leaf(NumberLiteral*) {}
+    void binary(BinaryExpr*) {}
+
+    void addUses(Expression* e) { walker.expression(e, *this); }
+
+    void enter(Frame::Kind kind, IfStmt* node, const NodeList& list) {
+        Frame frame;
+        frame.kind = kind;
+        frame.node = node;
+        frame.list = list;
+        frame.next = list.size();
+        frame.scratchMark = scratch.size();
+        frame.liveMark = live.mark();
+        frames.push_back(std::move(frame));
+    }
+
+    // Returns what is left of the list `frame` swept, in source order.
+    NodeList finish(const Frame& frame) {
+        size_t mark = frame.scratchMark;
+        const NodeList& list = frame.list;
+        std::reverse(scratch.begin() + mark, scratch.end());
+
+        NodeList result = list;
+        size_t kept = scratch.size() - mark;
+        if (kept != list.size() || !std::equal(scratch.begin() + mark, scratch.end(), list.begin())) {
+            result.count = static_cast<uint32_t>(kept);
+            result.items = arena.copyArray(scratch.data() + mark, kept);
+        }
+        scratch.resize(mark);
+        return result;
+    }
+
+    NodeList sweep(const NodeList& list) {
+        enter(Frame::ROOT, nullptr, list);
+        while (true) {
+            Frame& top = frames.back();
+            if (top.next > 0) {
+                sweepStatement(top.list[--top.next]);
+                continue;
+            }
+
+            Frame done = std::move(top);
+            frames.pop_back();
+            NodeList swept = finish(done);
+            switch (done.kind) {
+                case Frame::ROOT:
+                    return swept;
+                case Frame::TAKEN:
+                    for (size_t i = swept.size(); i-- > 0;) {
+                        scratch.push_back(swept[i]);
+                    }
+                    break;
+                case Frame::THEN: {
+                    auto thenLive = live.rollback(done.liveMark);
+                    enter(Frame::ELSE, done.node, done.node->elseBody);
+                    frames.back().thenBody = swept;
+                    frames.back().thenLive = std::move(thenLive);
+                    break;
+                }
+                case Frame::ELSE:
+                    finishIf(done, swept);
+                    break;
+            }
+        }
+    }
+
+    bool assignment(uint32_t sym, Expression* expr) {
+        if (!live.get(sym)) {
+            stats.deadStores++;
+            return false;
+        }
+        live.set(sym, false);
+        addUses(expr);
+        return true;
+    }
+
+    void sweepStatement(ASTNode* stmt) {
+        if (auto* decl = dynamic_cast<VarDeclAssign*>(stmt)) {
+            if (assignment(decl->sym, decl->expr)) scratch.push_back(stmt);
+        } else if (auto* assign = dynamic_cast<AssignStmt*>(stmt)) {
+            if (assignment(assign->sym, assign->expr)) scratch.push_back(stmt);
+        } else if (auto* ifStmt = dynamic_cast<IfStmt*>(stmt)) {
+            sweepIf(ifStmt);
+        } else {
+            scratch.push_back(stmt);
+        }
+    }
+
+    void sweepIf(IfStmt* node) {
+        auto* cmp = dynamic_cast<BinaryExpr*>(node->condition);
+        auto* lhs = cmp ? dynamic_cast<NumberLiteral*>(cmp->left) : nullptr;
+        auto* rhs = cmp ? dynamic_cast<NumberLiteral*>(cmp->right) : nullptr;
+        if (cmp && cmp->op == "==" && lhs && rhs) {
+            // Only one arm can run; splice it in place of the if.
+            stats.deadBranches++;
+            enter(Frame::TAKEN, node, lhs->value == rhs->value ? node->thenBody : node->elseBody);
+            return;
+        }
+        enter(Frame::THEN, node, node->thenBody);
+    }
+
+    // Live before the if: live into either arm, plus the condition's uses.
+    void finishIf(Frame& elseFrame, const NodeList& elseBody) {
+        IfStmt* node = elseFrame.node;
+        auto elseLive = live.rollback(elseFrame.liveMark);
+
+        live.mergeArms(elseFrame.thenLive, elseLive);
+        if (elseFrame.thenBody.empty() && elseBody.empty()) {
+            stats.emptyIfs++;
+            return;
+        }
+        node->thenBody = elseFrame.thenBody;
+        node->elseBody = elseBody;
+        addUses(node->condition);
+        scratch.push_back(node);
+    }
+};
+
+}
+
+
+DceStats eliminateDeadCode(Program& program, CompilationContext& ctx,
+                           const std::vector<uint8_t>& outputs) {
+    DeadCodeEliminator dce(program, ctx, outputs);
+    dce.stats.instrsBefore = codeSize(program.statements);
+    program.statements = dce.sweep(program.statements);
+    dce.stats.instrsAfter = codeSize(program.statements);
+    return dce.stats;
+}
@@ -0,0 +1,357 @@
+#include "driver.h"
+#include "lexer.h"
+#include "parser.h"
+#include "ast.h"
+#include "flat_ast.h"
+#include "cache.h"
+#include "const_fold.h"
+#include "dce.h"
+#include "slot_alloc.h"
+#include "pass_manager.h"
+#include "backend.h"
+#include "mapped_file.h"
+#include "output_writer.h"
+#include "thread_pool.h"
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+
+
+namespace {
+
+uint64_t parseSize(const std::string& text) {
+    size_t used = 0;
+    uint64_t value = std::stoull(text, &used);
+    std::string suffix = text.substr(used);
+    if (suffix == "K" || suffix == "k") value <<= 10;
+    else if (suffix == "M" || suffix == "m") value <<= 20;
+    else if (suffix == "G" || suffix == "g") value <<= 30;
+    else if (!suffix.empty()) throw std::invalid_argument("bad size suffix");
+    return value;
+}
+
+bool readManifest(const std::string& path, std::vector<std::string>& inputs) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty() && line[0] != '#') inputs.push_back(line);
+    }
+    return true;
+}
+
+}
+
+
+bool parseOptions(int argc, char* argv[], Options& opts, std::string& error) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--flat-ast") {
+            opts.flatAst = true;
+        } else if (arg == "-O0" || arg == "-O1") {
+            opts.optLevel = arg[2] - '0';
+        } else if (arg == "--no-dce") {
+            opts.dce = false;
+        } else if (arg == "--no-peephole") {
+            opts.peephole = false;
+        } else if (arg.rfind("--peephole=", 0) == 0) {
+            if (!parsePeepholeRules(arg.substr(11), opts.peepholeConfig, error)) {
+                return false;
+            }
+        } else if (arg.rfind("--peephole-window=", 0) == 0) {
+            opts.peepholeConfig.window = std::stoul(arg.substr(18));
+        } else if (arg.rfind("--dump-ir-after=", 0) == 0) {
+            opts.dumpIrAfter = arg.substr(16);
+            if (!isIrPassName(opts.dumpIrAfter)) {
+                error = "Unknown IR pass " + opts.dumpIrAfter;
+                return false;
+            }
+        } else if (arg == "--dump-tokens") {
+            opts.dumpTokens = true;
+        } else if (arg == "--dump-ast") {
+            opts.dumpAst = true;
+        } else if (arg == "--time-report" || arg == "--time-report=text") {
+            opts.timeReport = "text";
+        } else if (arg == "--time-report=json") {
+            opts.timeReport = "json";
+        } else if (arg.rfind("--lexer-scan=", 0) == 0) {
+            if (!selectScanKernels(arg.substr(13))) {
+                error = "Unsupported lexer scan kernels " + arg.substr(13);
+                return false;
+            }
+        } else if (arg.rfind("--target=", 0) == 0) {
+            opts.target = arg.substr(9);
+            if (!isTargetName(opts.target)) {
+                error = "Unknown target " + opts.target;
+                return false;
+            }
+        } else if (arg == "--emit=asm" || arg == "--emit=bin") {
+            opts.emitBinary = arg == "--emit=bin";
+        } else if (arg == "--assemble") {
+            opts.assemble = true;
+        } else if (arg.rfind("--run=", 0) == 0) {
+            opts.runPath = arg.substr(6);
+        } else if (arg == "--run" && i + 1 < argc) {
+            opts.runPath = argv[++i];
+        } else if (arg.rfind("--max-steps=", 0) == 0) {
+            opts.maxSteps = std::stoull(arg.substr(12));
+        } else if (arg == "--batch") {
+            opts.batch = true;
+        } else if (arg.rfind("--jobs=", 0) == 0) {
+            opts.jobs = static_cast<unsigned>(std::stoul(arg.substr(7)));
+        } else if (arg == "-j" && i + 1 < argc) {
+            opts.jobs = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg.rfind("--out-dir=", 0) == 0) {
+            opts.outDir = arg.substr(10);
+        } else if (arg.rfind("--cache-dir=", 0) == 0) {
+            opts.cacheDir = arg.substr(12);
+        } else if (arg.rfind("--cache-max-size=", 0) == 0) {
+            opts.cacheMaxBytes = parseSize(arg.substr(17));
+        } else if (arg.rfind("--", 0) == 0) {
+            error = "Unknown option " + arg;
+            return false;
+        } else {
+            opts.inputs.push_back(arg);
+        }
+    }
+
+    if (opts.emitBinary && opts.target != "abm") {
+        error = "--emit=bin is only supported for --target=abm";
+        return false;
+    }
+
+    if (opts.batch) {
+        std::vector<std::string> expanded;
+        for (auto& input : opts.inputs) {
+            if (input.size() > 1 && input[0] == '@') {
+                if (!readManifest(input.substr(1), expanded)) {
+                    error = "Could not open manifest " + input.substr(1);
+                    return false;
+                }
+            } else {
+                expanded.push_back(input);
+            }
+        }
+        opts.inputs = std::move(expanded);
+    }
+    return true;
+}
+
+std::string codegenSignature(const Options& opts) {
+    std::string sig = SLC_VERSION;
+    if (opts.flatAst) sig += " --flat-ast";
+    sig += " -O" + std::to_string(opts.optLevel);
+    if (opts.optLevel >= 1 && !opts.dce) sig += " --no-dce";
+    sig += " --target=" + opts.target;
+    if (opts.emitBinary) sig += " --emit=bin";
+    if (opts.optLevel >= 1 && opts.peephole) {
+        sig += " --peephole=";
+        for (int rule = 0; rule < PH_RULE_COUNT; rule++) {
+            if (opts.peepholeConfig.enabled[rule]) {
+                sig += peepholeRuleName(rule);
+                sig += ",";
+            }
+        }
+        sig += " --peephole-window=" + std::to_string(opts.peepholeConfig.window);
+    }
+    return sig;
+}
+
+CompileResult compileFile(const Options& opts, const std::string& inPath,
+                          const std::string& outPath, std::ostream* log,
+                          CompileCache* cache) {
+    CompileResult result;
+    PhaseTimer timer;
+    auto start = std::chrono::steady_clock::now();
+
+    // Map the source file; the lexer and every token read from the mapping,
+    // so it must outlive the token stream.
+    timer.begin("read");
+    MappedFile source;
+    if (!source.open(inPath)) {
+        result.error = "Could not open file " + inPath;
+        timer.end();
+        result.phases = timer.phases();
+        return result;
+    }
+    std::string_view program = source.view();
+    result.sourceBytes = program.size();
+
+    std::string cacheKey;
+    if (cache) {
+        timer.begin("cache");
+        cacheKey = CompileCache::key(program, codegenSignature(opts));
+        if (cache->fetch(cacheKey, outPath)) {
+            if (log) *log << "Compile cache hit (" << cacheKey << ")\n";
+            timer.end();
+            result.phases = timer.phases();
+            result.ok = true;
+            result.cached = true;
+            result.millis = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+            return result;
+        }
+    }
+
+    try {
+        // Step 1: Lexical analysis. The parser pulls tokens on demand, so a
+        // separate lexing pass only runs when its output or its time is wanted.
+        CompilationContext ctx;
+        Lexer lexer(program);
+
+        if (log && opts.dumpTokens) {
+            lexer.tokenize();
+            *log << "=== Lexer Output ===\n";
+            lexer.printTokens(*log);
+            *log << "\n";
+            lexer.reset();
+        }
+        if (!opts.timeReport.empty()) {
+            // Pull tokens without keeping them so the phase measures the
+            // lexer itself and not a token vector the parser never uses.
+            timer.begin("lex");
+            while (lexer.next().type != TOK_EOF) {
+            }
+            timer.end();
+            lexer.reset();
+        }
+
+        // Step 2: Syntax analysis. A big source is parsed, and later
+        // generated, in chunks on its own pool, unless this is a batch,
+        // which already keeps every thread busy with a file of its own.
+        timer.begin("parse");
+        std::unique_ptr<ThreadPool> pool;
+        if (!opts.batch && opts.jobs != 1 && program.size() >= PARALLEL_PARSE_MIN_BYTES) {
+            pool = std::make_unique<ThreadPool>(opts.jobs);
+            if (pool->size() < 2) pool.reset();
+        }
+        std::unique_ptr<Program> programNode;
+        if (pool) {
+            programNode = parseParallel(program, ctx, *pool);
+        } else {
+            Parser parser(lexer, ctx);
+            programNode = parser.parse();
+        }
+        timer.end();
+
+        if (log) {
+            *log << "Parsed " << programNode->statements.size() << " statements; AST arena: "
+                 << programNode->arena.objectCount() << " nodes, "
+                 << programNode->arena.bytesUsed() << " bytes used, "
+                 << programNode->arena.bytesReserved() << " bytes reserved\n";
+        }
+
+        // Step 3: Optimization passes over the AST. The outputs are taken
+        // first: dead code elimination can drop the declaration that made a
+        // variable a temporary, and it must not become an output after that.
+        std::vector<uint8_t> outputs = programNode->outputSymbols(ctx.symbols.size());
+        if (opts.optLevel >= 1) {
+            timer.begin("const-fold");
+            FoldStats folded = foldConstants(*programNode, ctx);
+            timer.end();
+            if (log) {
+                *log << "Constant folding: " << folded.foldedExprs << " expressions folded, "
+                     << folded.propagatedUses << " constant uses propagated\n";
+            }
+
+            if (opts.dce) {
+                timer.begin("dce");
+                DceStats dce = eliminateDeadCode(*programNode, ctx, outputs);
+                timer.end();
+                if (log) {
+                    *log << "Dead code: " << dce.deadStores << " dead stores, "
+                         << dce.deadBranches << " unreachable branches, "
+                         << dce.emptyIfs << " empty ifs removed; ~"
+                         << dce.instrsBefore - dce.instrsAfter << " of "
+                         << dce.instrsBefore << " instructions\n";
+                }
+            }
+
+            timer.begin("slot-alloc");
+            SlotStats slots = allocateSlots(*programNode, ctx, outputs);
+            timer.end();
+            if (log) {
+                *log << "Slot allocation: " << slots.variables << " variables, "
+                     << slots.slotsBefore << " memory slots before, "
+                     << slots.slotsAfter << " after\n";
+            }
+        }
+
+        // Step 4: Optional flattening and the AST dump
+        FlatAST flat;
+        if (opts.flatAst) {
+            timer.begin("flatten");
+            flat = FlatAST::build(programNode.get());
+            timer.end();
+        }
+        if (log && opts.dumpAst) {
+            *log << "=== Abstract Syntax Tree ===\n";
+            if (opts.flatAst) {
+                flat.print(ctx.symbols, *log);
+            } else {
+                PrintVisitor printer(ctx.symbols, *log);
+                programNode->accept(&printer);
+            }
+            *log << "\n";
+        }
+
+        // Step 5: Lowering to IR and the IR pass pipeline
+        timer.begin("lower");
+        IrProgram ir;
+        IrBuilder builder(ir);
+        if (opts.flatAst) {
+            flat.lower(ctx, builder);
+        } else {
+            programNode->lower(ctx, builder);
+        }
+        timer.end();
+
+        PassManager passes;
+        addStandardPasses(passes, opts.optLevel);
+        passes.run(ir, ctx.symbols, opts.dumpIrAfter, log ? *log : std::cerr, &timer);
+        if (log) {
+            passes.report(*log);
+        }
+
+        // Step 6: Code generation for the selected target
+        timer.begin("codegen");
+        std::unique_ptr<Backend> backend = makeBackend(opts);
+        OutputWriter out;
+        if (!out.open(outPath)) {
+            result.error = "Could not open output file " + outPath;
+            timer.end();
+            result.phases = timer.phases();
+            return result;
+        }
+        backend->generate(ir, ctx, outputs, out, log, pool.get());
+        if (!out.close()) {
+            result.error = "Could not write output file " + outPath;
+            timer.end();
+            result.phases = timer.phases();
+            return result;
+        }
+        timer.end();
+        if (log) {
+            *log << "Output: " << out.bytesWritten() << " bytes in "
+                 << out.systemCalls() << " write calls\n";
+        }
+        result.ok = true;
+
+        if (cache) {
+            timer.begin("cache-store");
+            cache->store(cacheKey, outPath);
+            timer.end();
+        }
+    } catch (const std::exception& e) {
+        result.error = e.what();
+    }
+
+    timer.end();
+    result.phases = timer.phases();
+    result.millis = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    return result;
+}
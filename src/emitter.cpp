@@ -0,0 +1,82 @@
+#include "emitter.h"
+
+
+Emitter::Emitter(InstrList& code, bool track)
+    : code(code), track(track), skipped(0) {
+}
+
+void Emitter::forget() {
+    regs[0] = RegState();
+    regs[1] = RegState();
+}
+
+void Emitter::loadImm(char reg, int value) {
+    RegState& r = regs[index(reg)];
+    if (track && r.hasConst && r.constant == value) {
+        skipped++;
+        return;
+    }
+    code.push_back(Instr(OP_LDI, reg, value));
+    r = RegState();
+    r.hasConst = true;
+    r.constant = value;
+}
+
+void Emitter::load(char reg, int addr) {
+    RegState& r = regs[index(reg)];
+    if (track && r.addr == addr) {
+        skipped++;
+        return;
+    }
+    code.push_back(Instr(OP_LOAD, reg, addr));
+
+    // If the other register mirrors the same cell, its constant carries over.
+    const RegState& other = regs[1 - index(reg)];
+    r = RegState();
+    r.addr = addr;
+    if (other.addr == addr && other.hasConst) {
+        r.hasConst = true;
+        r.constant = other.constant;
+    }
+}
+
+void Emitter::store(int addr) {
+    RegState& a = regs[0];
+    if (track && a.addr == addr) {
+        skipped++;
+        return;
+    }
+    code.push_back(Instr(OP_STORE, 'A', addr));
+
+    if (regs[1].addr == addr) {
+        regs[1].addr = -1;
+    }
+    a.addr = addr;
+}
+
+void Emitter::moveBA() {
+    code.push_back(Instr(OP_MOV_BA));
+    regs[1] = regs[0];
+}
+
+void Emitter::alu(Opcode op) {
+    code.push_back(Instr(op));
+
+    // cmp only sets flags; add and sub leave their result in A.
+    if (op != OP_CMP) {
+        regs[0] = RegState();
+    }
+}
+
+void Emitter::jump(Opcode op, const char* prefix, int id) {
+    code.push_back(Instr(op, 0, id, prefix));
+}
+
+void Emitter::label(const char* prefix, int id) {
+    code.push_back(Instr(OP_LABEL, 0, id, prefix));
+    forget();
+}
+
+void Emitter::halt() {
+    code.push_back(Instr(OP_HLT));
+}
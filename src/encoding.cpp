@@ -0,0 +1,144 @@
+#include "encoding.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+
+
+namespace {
+
+const uint8_t REG_B = 0x10;
+
+bool hasOperand(Opcode op) {
+    return op == OP_LDI || op == OP_LOAD || op == OP_STORE || op == OP_JMP || op == OP_JNZ;
+}
+
+void putWord(uint8_t* p, uint32_t value) {
+    p[0] = static_cast<uint8_t>(value);
+    p[1] = static_cast<uint8_t>(value >> 8);
+    p[2] = static_cast<uint8_t>(value >> 16);
+    p[3] = static_cast<uint8_t>(value >> 24);
+}
+
+uint32_t getWord(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+struct LabelKey {
+    std::string_view prefix;
+    int number;
+
+    bool operator==(const LabelKey& other) const {
+        return number == other.number && prefix == other.prefix;
+    }
+};
+
+struct LabelHash {
+    size_t operator()(const LabelKey& key) const {
+        return std::hash<std::string_view>()(key.prefix) * 31 + static_cast<size_t>(key.number);
+    }
+};
+
+}
+
+
+bool encodeProgram(const InstrList& code, std::vector<uint8_t>& image, std::string& error) {
+    size_t base = image.size();
+    image.resize(base + IMAGE_HEADER_SIZE + code.size() * 5);
+    std::memcpy(image.data() + base, IMAGE_MAGIC, 4);
+    uint8_t* start = image.data() + base + IMAGE_HEADER_SIZE;
+    uint8_t* p = start;
+
+    std::unordered_map<LabelKey, uint32_t, LabelHash> labels;
+    std::vector<std::pair<uint32_t, LabelKey>> fixups;     // operand offset, label
+
+    for (const Instr& instr : code) {
+        if (instr.op == OP_LABEL) {
+            labels[{instr.label, instr.arg}] = static_cast<uint32_t>(p - start);
+            continue;
+        }
+        *p++ = static_cast<uint8_t>(instr.op | (instr.reg == 'B' ? REG_B : 0));
+        if (!hasOperand(instr.op)) continue;
+
+        if (instr.op == OP_JMP || instr.op == OP_JNZ) {
+            fixups.push_back({static_cast<uint32_t>(p - start), {instr.label, instr.arg}});
+            putWord(p, 0);
+        } else {
+            putWord(p, static_cast<uint32_t>(instr.arg));
+        }
+        p += 4;
+    }
+
+    for (auto& fixup : fixups) {
+        auto it = labels.find(fixup.second);
+        if (it == labels.end()) {
+            error = "undefined label " + std::string(fixup.second.prefix) +
+                    (fixup.second.number >= 0 ? std::to_string(fixup.second.number) : "");
+            return false;
+        }
+        putWord(start + fixup.first, it->second);
+    }
+
+    uint32_t size = static_cast<uint32_t>(p - start);
+    putWord(image.data() + base + 4, size);
+    image.resize(base + IMAGE_HEADER_SIZE + size);
+    return true;
+}
+
+bool isImage(const std::vector<uint8_t>& bytes) {
+    return bytes.size() >= IMAGE_HEADER_SIZE && std::memcmp(bytes.data(), IMAGE_MAGIC, 4) == 0;
+}
+
+bool decodeProgram(const std::vector<uint8_t>& image, Arena& labels, InstrList& code, std::string& error) {
+    if (!isImage(image) || getWord(image.data() + 4) != image.size() - IMAGE_HEADER_SIZE) {
+        error = "not a valid image";
+        return false;
+    }
+    const uint8_t* start = image.data() + IMAGE_HEADER_SIZE;
+    size_t size = image.size() - IMAGE_HEADER_SIZE;
+
+    // Decode first, then place a label in front of every jump target.
+    std::vector<std::pair<uint32_t, Instr>> decoded;
+    std::vector<uint32_t> targets;
+    const char* prefix = labels.copyArray("L", 2);
+    for (size_t pos = 0; pos < size;) {
+        uint32_t at = static_cast<uint32_t>(pos);
+        uint8_t byte = start[pos++];
+        Opcode op = static_cast<Opcode>(byte & 0x0f);
+        if (op >= OP_COUNT || op == OP_LABEL || (hasOperand(op) && pos + 4 > size)) {
+            error = "bad instruction at offset " + std::to_string(at);
+            return false;
+        }
+        Instr instr(op, (byte & REG_B) ? 'B' : (op == OP_LDI || op == OP_LOAD || op == OP_STORE) ? 'A' : 0);
+        if (hasOperand(op)) {
+            instr.arg = static_cast<int>(getWord(start + pos));
+            pos += 4;
+        }
+        if (op == OP_JMP || op == OP_JNZ) {
+            instr.label = prefix;
+            targets.push_back(static_cast<uint32_t>(instr.arg));
+        }
+        decoded.push_back({at, instr});
+    }
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+    size_t t = 0;
+    for (auto& entry : decoded) {
+        for (; t < targets.size() && targets[t] <= entry.first; t++) {
+            if (targets[t] != entry.first) break;
+            code.push_back(Instr(OP_LABEL, 0, static_cast<int>(targets[t]), prefix));
+        }
+        if (t < targets.size() && targets[t] < entry.first) break;
+        code.push_back(entry.second);
+    }
+    if (t < targets.size() && targets[t] == size) {
+        code.push_back(Instr(OP_LABEL, 0, static_cast<int>(targets[t++]), prefix));
+    }
+    if (t != targets.size()) {
+        error = "jump to offset " + std::to_string(targets[t]) + ", which starts no instruction";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,264 @@
+#include "flat_ast.h"
+#include "ast.h"
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+
+namespace {
+
+// Walks the pointer AST once and appends to the flat arrays. Expression
+// nodes are appended post-order as the walker finishes them, with the
+// indices of finished operands kept on `operands`.
+class FlatBuilder {
+public:
+    FlatAST& flat;
+    TreeWalker walker;
+    std::vector<uint32_t> operands;
+
+    FlatBuilder(FlatAST& f) : flat(f) {}
+
+    void addStmt(FlatStmtKind kind, uint32_t sym = 0, uint32_t expr = 0) {
+        flat.stmtKind.push_back(kind);
+        flat.stmtSym.push_back(sym);
+        flat.stmtExpr.push_back(expr);
+    }
+
+    uint32_t addExpr(FlatExprKind kind, uint32_t lhs, uint32_t rhs = 0) {
+        flat.exprKind.push_back(kind);
+        flat.exprLhs.push_back(lhs);
+        flat.exprRhs.push_back(rhs);
+        return static_cast<uint32_t>(flat.exprKind.size() - 1);
+    }
+
+    uint32_t expr(Expression* e) {
+        walker.expression(e, *this);
+        uint32_t root = operands.back();
+        operands.pop_back();
+        return root;
+    }
+
+    void statement(VarDecl* node) { addStmt(FS_VAR_DECL, node->sym); }
+    void statement(VarDeclAssign* node) { addStmt(FS_VAR_DECL_ASSIGN, node->sym, expr(node->expr)); }
+    void statement(AssignStmt* node) { addStmt(FS_ASSIGN, node->sym, expr(node->expr)); }
+
+    void beginIf(IfStmt* node) { addStmt(FS_IF, 0, expr(node->condition)); }
+    void elseIf(IfStmt*) { addStmt(FS_ELSE); }
+    void endIf(IfStmt*) { addStmt(FS_ENDIF); }
+
+    void binary(BinaryExpr* node) {
+        FlatExprKind kind;
+        if (node->op == "+") kind = FE_ADD;
+        else if (node->op == "-") kind = FE_SUB;
+        else if (node->op == "==") kind = FE_EQ;
+        else throw std::runtime_error("Unsupported operator in flat AST: " + std::string(node->op));
+
+        uint32_t rhs = operands.back();
+        operands.pop_back();
+        operands.back() = addExpr(kind, operands.back(), rhs);
+    }
+
+    void leaf(Identifier* node) {
+        operands.push_back(addExpr(FE_IDENT, node->sym));
+    }
+
+    void leaf(NumberLiteral* node) {
+        operands.push_back(addExpr(FE_NUMBER, static_cast<uint32_t>(node->value)));
+    }
+};
+
+void printIndent(std::ostream& out, int indent) {
+    for (int i = 0; i < indent; i++) {
+        out << "  ";
+    }
+}
+
+const char* opText(uint8_t kind) {
+    switch (kind) {
+        case FE_ADD: return "+";
+        case FE_SUB: return "-";
+        default: return "==";
+    }
+}
+
+}
+
+
+FlatAST FlatAST::build(Program* program) {
+    FlatAST flat;
+    FlatBuilder builder(flat);
+    builder.walker.statements(program->statements, builder);
+    return flat;
+}
+
+void FlatAST::printExpr(const SymbolTable& symbols, std::ostream& out, uint32_t root, int indent) const {
+    std::vector<std::pair<uint32_t, int>> stack;
+    stack.push_back({root, indent});
+
+    while (!stack.empty()) {
+        auto [e, depth] = stack.back();
+        stack.pop_back();
+        printIndent(out, depth);
+
+        switch (exprKind[e]) {
+            case FE_IDENT:
+                out << "Identifier: " << symbols.name(exprLhs[e]) << "\n";
+                break;
+            case FE_NUMBER:
+                out << "Number: " << static_cast<int>(exprLhs[e]) << "\n";
+                break;
+            default:
+                out << "BinaryExpr: " << opText(exprKind[e]) << "\n";
+                stack.push_back({exprRhs[e], depth + 1});
+                stack.push_back({exprLhs[e], depth + 1});
+                break;
+        }
+    }
+}
+
+// Produces the same text as PrintVisitor does for the pointer AST.
+void FlatAST::print(const SymbolTable& symbols, std::ostream& out) const {
+    out << "Program:\n";
+    int indent = 1;
+
+    for (size_t i = 0; i < stmtKind.size(); i++) {
+        switch (stmtKind[i]) {
+            case FS_VAR_DECL:
+                printIndent(out, indent);
+                out << "VarDecl: " << symbols.name(stmtSym[i]) << "\n";
+                break;
+            case FS_VAR_DECL_ASSIGN:
+                printIndent(out, indent);
+                out << "VarDeclAssign: " << symbols.name(stmtSym[i]) << " = \n";
+                printExpr(symbols, out, stmtExpr[i], indent + 1);
+                break;
+            case FS_ASSIGN:
+                printIndent(out, indent);
+                out << "Assignment: " << symbols.name(stmtSym[i]) << " = \n";
+                printExpr(symbols, out, stmtExpr[i], indent + 1);
+                break;
+            case FS_IF:
+                printIndent(out, indent);
+                out << "IfStmt:\n";
+                printIndent(out, indent + 1);
+                out << "Condition:\n";
+                printExpr(symbols, out, stmtExpr[i], indent + 2);
+                printIndent(out, indent + 1);
+                out << "Then Body:\n";
+                indent += 2;
+                break;
+            case FS_ELSE:
+                if (stmtKind[i + 1] != FS_ENDIF) {
+                    printIndent(out, indent - 1);
+                    out << "Else Body:\n";
+                }
+                break;
+            case FS_ENDIF:
+                indent -= 2;
+                break;
+        }
+    }
+}
+
+// Post-order over the pool: an entry is expanded into its operands the first
+// time it is popped and lowered the second time, with finished operands
+// waiting on `values`.
+IrValue FlatAST::lowerExpr(IrBuilder& ir, uint32_t expr, LowerStacks& stacks) const {
+    auto& pending = stacks.pending;
+    auto& values = stacks.values;
+    pending.push_back({expr, false});
+
+    while (!pending.empty()) {
+        auto [e, expanded] = pending.back();
+        pending.pop_back();
+        switch (exprKind[e]) {
+            case FE_IDENT:
+                values.push_back(IrValue::var(exprLhs[e]));
+                break;
+            case FE_NUMBER:
+                values.push_back(IrValue::constant(static_cast<int>(exprLhs[e])));
+                break;
+            case FE_EQ:
+                throw std::runtime_error("'==' is only supported as an if condition");
+            default: {
+                if (!expanded) {
+                    pending.push_back({e, true});
+                    pending.push_back({exprRhs[e], false});
+                    pending.push_back({exprLhs[e], false});
+                    break;
+                }
+                IrValue rhs = values.back();
+                values.pop_back();
+                IrValue result = ir.newTemp();
+                ir.emit(exprKind[e] == FE_ADD ? IR_ADD : IR_SUB, result, values.back(), rhs);
+                values.back() = result;
+                break;
+            }
+        }
+    }
+
+    IrValue result = values.back();
+    values.pop_back();
+    return result;
+}
+
+// Produces the same IR as Program::lower.
+void FlatAST::lower(CompilationContext& ctx, IrBuilder& ir) const {
+    struct OpenIf {
+        int id;
+        int head;
+        IrValue lhs, rhs;
+        bool isEq;
+        int thenBlock, thenEnd, elseBlock;
+    };
+    std::vector<OpenIf> openIfs;
+    LowerStacks stacks;
+
+    for (size_t i = 0; i < stmtKind.size(); i++) {
+        switch (stmtKind[i]) {
+            case FS_VAR_DECL:
+                break;
+            case FS_VAR_DECL_ASSIGN:
+            case FS_ASSIGN:
+                ir.assign(IrValue::var(stmtSym[i]), lowerExpr(ir, stmtExpr[i], stacks));
+                break;
+            case FS_IF: {
+                OpenIf open;
+                open.id = ctx.newLabel();
+                uint32_t cond = stmtExpr[i];
+                open.isEq = exprKind[cond] == FE_EQ;
+                if (open.isEq) {
+                    open.lhs = lowerExpr(ir, exprLhs[cond], stacks);
+                    open.rhs = lowerExpr(ir, exprRhs[cond], stacks);
+                } else {
+                    open.lhs = lowerExpr(ir, cond, stacks);
+                    open.rhs = IrValue::constant(0);
+                }
+                open.head = ir.currentBlock();
+                open.thenBlock = ir.newBlock();
+                openIfs.push_back(open);
+                break;
+            }
+            case FS_ELSE: {
+                OpenIf& open = openIfs.back();
+                open.thenEnd = ir.currentBlock();
+                open.elseBlock = ir.newBlock("else_", open.id);
+                break;
+            }
+            case FS_ENDIF: {
+                OpenIf& open = openIfs.back();
+                int elseEnd = ir.currentBlock();
+                int join = ir.newBlock("endif_", open.id);
+                if (open.isEq) {
+                    ir.setBranch(open.head, open.lhs, open.rhs, open.thenBlock, open.elseBlock);
+                } else {
+                    ir.setBranch(open.head, open.lhs, open.rhs, open.elseBlock, open.thenBlock);
+                }
+                ir.setJump(open.thenEnd, join);
+                ir.setJump(elseEnd, join);
+                openIfs.pop_back();
+                break;
+            }
+        }
+    }
+}
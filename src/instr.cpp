@@ -0,0 +1,137 @@
+#include "instr.h"
+#include <charconv>
+
+
+namespace {
+
+void printLabel(OutputWriter& out, const Instr& instr) {
+    out << instr.label;
+    if (instr.arg >= 0) out << instr.arg;
+}
+
+const char* const opcodeNames[OP_COUNT] = {
+    "ldi", "load", "store", "mov", "add", "sub", "cmp", "jmp", "jnz", "label", "hlt",
+};
+
+std::string_view nextWord(std::string_view& line) {
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string_view::npos) {
+        line = std::string_view();
+        return line;
+    }
+    size_t end = line.find_first_of(" \t", start);
+    if (end == std::string_view::npos) end = line.size();
+    std::string_view word = line.substr(start, end - start);
+    line.remove_prefix(end);
+    return word;
+}
+
+bool parseInt(std::string_view word, int& value) {
+    auto result = std::from_chars(word.data(), word.data() + word.size(), value);
+    return result.ec == std::errc() && result.ptr == word.data() + word.size();
+}
+
+// Splits "else_12" into the prefix "else_" and 12; a name without trailing
+// digits keeps the whole name as its prefix and gets number -1.
+Instr labelRef(Opcode op, std::string_view name, Arena& labels) {
+    size_t digits = name.size();
+    while (digits > 0 && name[digits - 1] >= '0' && name[digits - 1] <= '9') digits--;
+    int number = -1;
+    if (digits < name.size() && !parseInt(name.substr(digits), number)) {
+        digits = name.size();
+        number = -1;
+    }
+    char* prefix = static_cast<char*>(labels.allocate(digits + 1, 1));
+    std::memcpy(prefix, name.data(), digits);
+    prefix[digits] = '\0';
+    return Instr(op, 0, number, prefix);
+}
+
+bool isReg(std::string_view word) {
+    return word == "A" || word == "B";
+}
+
+}
+
+
+void printInstr(OutputWriter& out, const Instr& instr) {
+    switch (instr.op) {
+        case OP_LDI:   out << "ldi " << instr.reg << " " << instr.arg << "\n"; break;
+        case OP_LOAD:  out << "mov " << instr.reg << " M " << instr.arg << "\n"; break;
+        case OP_STORE: out << "mov M A " << instr.arg << "\n"; break;
+        case OP_MOV_BA: out << "mov B A\n"; break;
+        case OP_ADD:   out << "add\n"; break;
+        case OP_SUB:   out << "sub\n"; break;
+        case OP_CMP:   out << "cmp\n"; break;
+        case OP_JMP:   out << "jmp %"; printLabel(out, instr); out << "\n"; break;
+        case OP_JNZ:   out << "jnz %"; printLabel(out, instr); out << "\n"; break;
+        case OP_LABEL: printLabel(out, instr); out << ":\n"; break;
+        case OP_HLT:   out << "hlt\n"; break;
+        case OP_COUNT: break;
+    }
+}
+
+void printProgram(OutputWriter& out, const InstrList& code) {
+    out << ".text\n";
+    for (const Instr& instr : code) {
+        printInstr(out, instr);
+    }
+}
+
+const char* opcodeName(Opcode op) {
+    return op < OP_COUNT ? opcodeNames[op] : "?";
+}
+
+bool parseProgram(std::string_view text, Arena& labels, InstrList& code, std::string& error) {
+    size_t lineNo = 0;
+    while (!text.empty()) {
+        size_t eol = text.find('\n');
+        std::string_view line = text.substr(0, eol);
+        text.remove_prefix(eol == std::string_view::npos ? text.size() : eol + 1);
+        lineNo++;
+
+        size_t comment = line.find(';');
+        if (comment != std::string_view::npos) line = line.substr(0, comment);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+        std::string_view op = nextWord(line);
+        if (op.empty() || op == ".text") continue;
+
+        bool ok = false;
+        int value = 0;
+        if (op.back() == ':' && op.size() > 1) {
+            code.push_back(labelRef(OP_LABEL, op.substr(0, op.size() - 1), labels));
+            ok = nextWord(line).empty();
+        } else if (op == "ldi") {
+            std::string_view reg = nextWord(line);
+            ok = isReg(reg) && parseInt(nextWord(line), value);
+            code.push_back(Instr(OP_LDI, reg.empty() ? 0 : reg[0], value));
+        } else if (op == "mov") {
+            std::string_view dst = nextWord(line);
+            std::string_view src = nextWord(line);
+            if (dst == "M" && src == "A") {
+                ok = parseInt(nextWord(line), value);
+                code.push_back(Instr(OP_STORE, 'A', value));
+            } else if (isReg(dst) && src == "M") {
+                ok = parseInt(nextWord(line), value);
+                code.push_back(Instr(OP_LOAD, dst[0], value));
+            } else if (dst == "B" && src == "A") {
+                ok = true;
+                code.push_back(Instr(OP_MOV_BA));
+            }
+        } else if (op == "add" || op == "sub" || op == "cmp" || op == "hlt") {
+            ok = true;
+            code.push_back(Instr(op == "add" ? OP_ADD : op == "sub" ? OP_SUB : op == "cmp" ? OP_CMP : OP_HLT));
+        } else if (op == "jmp" || op == "jnz") {
+            std::string_view target = nextWord(line);
+            ok = target.size() > 1 && target[0] == '%';
+            if (ok) code.push_back(labelRef(op == "jmp" ? OP_JMP : OP_JNZ, target.substr(1), labels));
+        }
+
+        if (!ok || !nextWord(line).empty()) {
+            error = "line " + std::to_string(lineNo) + ": cannot parse '" + std::string(op) + "'";
+            return false;
+        }
+    }
+    return true;
+}
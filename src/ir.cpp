@@ -0,0 +1,113 @@
+#include "ir.h"
+
+
+void IrProgram::compact(const std::vector<uint8_t>& keep) {
+    std::vector<int> renumber(blocks.size(), -1);
+    size_t kept = 0;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        if (keep[i]) {
+            renumber[i] = static_cast<int>(kept);
+            if (kept != i) blocks[kept] = std::move(blocks[i]);
+            kept++;
+        }
+    }
+    blocks.resize(kept);
+
+    for (IrBlock& block : blocks) {
+        if (block.term.target >= 0) block.term.target = renumber[block.term.target];
+        if (block.term.other >= 0) block.term.other = renumber[block.term.other];
+    }
+}
+
+
+IrBuilder::IrBuilder(IrProgram& program) : ir(program), current(-1) {
+    newBlock();
+}
+
+int IrBuilder::newBlock(const char* labelPrefix, int labelId) {
+    ir.blocks.emplace_back();
+    ir.blocks.back().labelPrefix = labelPrefix;
+    ir.blocks.back().labelId = labelId;
+    current = static_cast<int>(ir.blocks.size() - 1);
+    return current;
+}
+
+void IrBuilder::emit(IrOp op, IrValue dst, IrValue a, IrValue b) {
+    ir.blocks[current].code.push_back({op, dst, a, b});
+}
+
+void IrBuilder::assign(IrValue dst, IrValue value) {
+    std::vector<IrInstr>& code = ir.blocks[current].code;
+    if (value.kind == IrValue::TEMP && !code.empty() && code.back().dst == value) {
+        code.back().dst = dst;
+        return;
+    }
+    emit(IR_COPY, dst, value);
+}
+
+void IrBuilder::setBranch(int block, IrValue a, IrValue b, int target, int other) {
+    IrTerminator& term = ir.blocks[block].term;
+    term.kind = IR_BRANCH;
+    term.a = a;
+    term.b = b;
+    term.target = target;
+    term.other = other;
+}
+
+void IrBuilder::setJump(int block, int target) {
+    IrTerminator& term = ir.blocks[block].term;
+    term.kind = IR_GOTO;
+    term.target = target;
+}
+
+
+namespace {
+
+void printValue(const IrValue& value, const SymbolTable& symbols, std::ostream& out) {
+    switch (value.kind) {
+        case IrValue::CONST: out << value.id; break;
+        case IrValue::VAR:   out << symbols.name(static_cast<uint32_t>(value.id)); break;
+        case IrValue::TEMP:  out << "%t" << value.id; break;
+        case IrValue::NONE:  out << "?"; break;
+    }
+}
+
+}
+
+void printIr(const IrProgram& ir, const SymbolTable& symbols, std::ostream& out) {
+    for (size_t i = 0; i < ir.blocks.size(); i++) {
+        const IrBlock& block = ir.blocks[i];
+        out << "bb" << i;
+        if (block.labelPrefix) out << " (" << block.labelPrefix << block.labelId << ")";
+        out << ":\n";
+
+        for (const IrInstr& instr : block.code) {
+            out << "    ";
+            printValue(instr.dst, symbols, out);
+            out << " = ";
+            printValue(instr.a, symbols, out);
+            if (instr.op != IR_COPY) {
+                out << (instr.op == IR_ADD ? " + " : " - ");
+                printValue(instr.b, symbols, out);
+            }
+            out << "\n";
+        }
+
+        const IrTerminator& term = block.term;
+        switch (term.kind) {
+            case IR_HALT:
+                out << "    halt\n";
+                break;
+            case IR_GOTO:
+                out << "    goto bb" << term.target << "\n";
+                break;
+            case IR_BRANCH:
+                out << "    if ";
+                printValue(term.a, symbols, out);
+                out << " == ";
+                printValue(term.b, symbols, out);
+                out << " goto bb" << term.target << " else bb" << term.other << "\n";
+                break;
+        }
+    }
+}
@@ -0,0 +1,70 @@
+#include "pass_manager.h"
+
+
+bool foldBranches(IrProgram& ir) {
+    bool changed = false;
+    for (IrBlock& block : ir.blocks) {
+        IrTerminator& term = block.term;
+        if (term.kind != IR_BRANCH) continue;
+
+        bool bothConst = term.a.kind == IrValue::CONST && term.b.kind == IrValue::CONST;
+        bool sameVar = term.a.kind == IrValue::VAR && term.a == term.b;
+        if (!bothConst && !sameVar) continue;
+
+        term.kind = IR_GOTO;
+        if (term.a.id != term.b.id) term.target = term.other;
+        term.other = -1;
+        term.a = term.b = IrValue();
+        changed = true;
+    }
+    return changed;
+}
+
+bool threadJumps(IrProgram& ir) {
+    // Forward-only control flow: following gotos always terminates.
+    auto skip = [&](int target) {
+        while (ir.blocks[target].code.empty() && ir.blocks[target].term.kind == IR_GOTO) {
+            target = ir.blocks[target].term.target;
+        }
+        return target;
+    };
+
+    bool changed = false;
+    for (IrBlock& block : ir.blocks) {
+        IrTerminator& term = block.term;
+        if (term.kind == IR_HALT) continue;
+        int target = skip(term.target);
+        int other = term.kind == IR_BRANCH ? skip(term.other) : -1;
+        if (target != term.target || other != term.other) {
+            term.target = target;
+            term.other = other;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool removeUnreachable(IrProgram& ir) {
+    std::vector<uint8_t> reached(ir.blocks.size(), 0);
+    std::vector<int> work;
+    reached[0] = 1;
+    work.push_back(0);
+    while (!work.empty()) {
+        const IrTerminator& term = ir.blocks[work.back()].term;
+        work.pop_back();
+        for (int next : {term.target, term.other}) {
+            if (next >= 0 && !reached[next]) {
+                reached[next] = 1;
+                work.push_back(next);
+            }
+        }
+    }
+
+    for (uint8_t r : reached) {
+        if (!r) {
+            ir.compact(reached);
+            return true;
+        }
+    }
+    return false;
+}
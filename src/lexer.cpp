@@ -1,120 +1,176 @@
 
 
 #include "lexer.h"
+#include <algorithm>
+#include <array>
+#include <climits>
 #include <iostream>
-#include <cctype>
+#include <stdexcept>
+#include <string>
 
 
-Lexer::Lexer(std::string code) {
-    input = code;
-    pos = 0;
-    
+namespace {
+
+struct Keyword {
+    std::string_view text;
+    TokenType type;
+};
+
+constexpr Keyword keywords[] = {
+    {"int", TOK_INT},
+    {"if", TOK_IF},
+    {"else", TOK_ELSE},
+};
+
+constexpr size_t KEYWORD_SLOTS = 8;     // power of two, at least twice the keyword count
+constexpr size_t MAX_KEYWORD_LENGTH = 4;
+
+// Length, first and last byte are all an identifier contributes, so hashing
+// never walks the identifier. The seed is searched for at compile time.
+constexpr size_t keywordHash(std::string_view id, unsigned seed) {
+    return (static_cast<unsigned char>(id.front()) * seed + static_cast<unsigned char>(id.back()) + id.size())
+           & (KEYWORD_SLOTS - 1);
 }
 
-void Lexer::tokenize() {
-    while (!isAtEnd()) {
-   
-        if (std::isspace(input[pos])) {
-            skipWhitespace();
-        }
-     
-        else if (std::isalpha(input[pos])) {
-            readIdentifier();  
-        }
-      
-        else if (std::isdigit(input[pos])) {
-            readNumber();
-        }
-    
-        else {
-            char c = input[pos];
-            switch (c) {
-                case '=':
-                    
-                    if (pos + 1 < input.length() && input[pos + 1] == '=') {
-                        tokens.push_back(Token(TOK_EQ, "=="));
-                        pos += 2;  
-                    } else {
-                        tokens.push_back(Token(TOK_ASSIGN, "="));
-                        pos++;
-                    }
-                    break;
-                case '+':
-                    tokens.push_back(Token(TOK_PLUS, "+"));
-                    pos++;
-                    break;
-                case '-':
-                    tokens.push_back(Token(TOK_MINUS, "-"));
-                    pos++;
-                    break;
-                case '{':
-                    tokens.push_back(Token(TOK_LBRACE, "{"));
-                    pos++;
-                    break;
-                case '}':
-                    tokens.push_back(Token(TOK_RBRACE, "}"));
-                    pos++;
-                    break;
-                case '(':
-                    tokens.push_back(Token(TOK_LPAREN, "("));
-                    pos++;
-                    break;
-                case ')':
-                    tokens.push_back(Token(TOK_RPAREN, ")"));
-                    pos++;
-                    break;
-                case ';':
-                    tokens.push_back(Token(TOK_SEMI, ";"));
-                    pos++;
-                    break;
-                default:
-                 
-                    tokens.push_back(Token(TOK_UNKNOWN, std::string(1, c)));
-                    pos++;
-                    break;
-            }
+constexpr unsigned findKeywordSeed() {
+    for (unsigned seed = 1; seed < 1024; seed++) {
+        bool used[KEYWORD_SLOTS] = {};
+        bool ok = true;
+        for (const Keyword& k : keywords) {
+            size_t slot = keywordHash(k.text, seed);
+            ok = ok && !used[slot];
+            used[slot] = true;
         }
+        if (ok) return seed;
     }
-  
-    tokens.push_back(Token(TOK_EOF, ""));
+    return 0;
 }
 
+constexpr unsigned KEYWORD_SEED = findKeywordSeed();
+static_assert(KEYWORD_SEED != 0, "no collision-free seed for the keyword table; grow KEYWORD_SLOTS");
 
-void Lexer::readIdentifier() {
-    std::string id = "";
-   
-    while (!isAtEnd() && (std::isalnum(input[pos]) || input[pos] == '_')) {
-        id += input[pos];
-        pos++;
+// Keyword index + 1 per slot; 0 marks an empty slot.
+constexpr std::array<uint8_t, KEYWORD_SLOTS> makeKeywordTable() {
+    std::array<uint8_t, KEYWORD_SLOTS> table{};
+    for (size_t i = 0; i < std::size(keywords); i++) {
+        table[keywordHash(keywords[i].text, KEYWORD_SEED)] = static_cast<uint8_t>(i + 1);
     }
-    
-   
-    if (id == "int") {
-        tokens.push_back(Token(TOK_INT, id));
-    } else if (id == "if") {
-        tokens.push_back(Token(TOK_IF, id));
-    } else if (id == "else") {  
-        tokens.push_back(Token(TOK_ELSE, id));
-    } else {
-       
-        tokens.push_back(Token(TOK_ID, id));
+    return table;
+}
+
+constexpr std::array<uint8_t, KEYWORD_SLOTS> keywordTable = makeKeywordTable();
+
+constexpr TokenType keywordType(std::string_view id) {
+    if (id.size() > MAX_KEYWORD_LENGTH) return TOK_ID;
+    uint8_t entry = keywordTable[keywordHash(id, KEYWORD_SEED)];
+    if (entry == 0 || keywords[entry - 1].text != id) return TOK_ID;
+    return keywords[entry - 1].type;
+}
+
+static_assert(keywordType("int") == TOK_INT && keywordType("if") == TOK_IF &&
+              keywordType("else") == TOK_ELSE && keywordType("in") == TOK_ID &&
+              keywordType("elsewhere") == TOK_ID);
+
+}
+
+
+
+Lexer::Lexer(std::string_view code, size_t begin)
+    : input(code), begin(begin), pos(begin), scan(&scanKernels()) {
+}
+
+Token Lexer::makeToken(TokenType type, size_t start, size_t len, int value) {
+    return Token(type, input.substr(start, len), value);
+}
+
+void Lexer::tokenize() {
+    // Roughly one token per four source bytes; avoids regrowing on big inputs.
+    tokens.reserve((input.size() - begin) / 4 + 1);
+
+    Token t;
+    do {
+        t = next();
+        tokens.push_back(t);
+    } while (t.type != TOK_EOF);
+}
+
+void Lexer::reset() {
+    pos = begin;
+    tokens.clear();
+}
+
+Token Lexer::next() {
+    skipWhitespace();
+
+    if (isAtEnd()) {
+        return makeToken(TOK_EOF, pos, 0);
+    }
+
+    uint8_t cls = charClasses[static_cast<unsigned char>(input[pos])];
+    if (cls & CC_ALPHA) {
+        return readIdentifier();
+    }
+
+    if (cls & CC_DIGIT) {
+        return readNumber();
+    }
+
+    size_t start = pos++;
+    switch (input[start]) {
+        case '=':
+
+            if (!isAtEnd() && input[pos] == '=') {
+                pos++;
+                return makeToken(TOK_EQ, start, 2);
+            }
+            return makeToken(TOK_ASSIGN, start, 1);
+        case '+': return makeToken(TOK_PLUS, start, 1);
+        case '-': return makeToken(TOK_MINUS, start, 1);
+        case '{': return makeToken(TOK_LBRACE, start, 1);
+        case '}': return makeToken(TOK_RBRACE, start, 1);
+        case '(': return makeToken(TOK_LPAREN, start, 1);
+        case ')': return makeToken(TOK_RPAREN, start, 1);
+        case ';': return makeToken(TOK_SEMI, start, 1);
+        default:
+
+            return makeToken(TOK_UNKNOWN, start, 1);
     }
 }
 
-void Lexer::readNumber() {
-    std::string num = "";
-    
-    while (!isAtEnd() && std::isdigit(input[pos])) {
-        num += input[pos];
-        pos++;
+
+Token Lexer::readIdentifier() {
+    size_t start = pos;
+
+    pos = scan->skipIdent(input.data(), pos + 1, input.size());
+    std::string_view id = input.substr(start, pos - start);
+    return makeToken(keywordType(id), start, id.size());
+}
+
+Token Lexer::readNumber() {
+    size_t start = pos;
+    int value = 0;
+
+    pos = scan->skipDigits(input.data(), pos + 1, input.size());
+    for (size_t i = start; i < pos; i++) {
+        int digit = input[i] - '0';
+        if (value > (INT_MAX - digit) / 10) {
+            size_t line = 1 + std::count(input.begin(), input.begin() + start, '\n');
+            throw std::runtime_error("line " + std::to_string(line) + ": integer literal " +
+                                     std::string(input.substr(start, pos - start)) + " does not fit in int");
+        }
+        value = value * 10 + digit;
     }
-    tokens.push_back(Token(TOK_NUM, num));
+    return makeToken(TOK_NUM, start, pos - start, value);
 }
 
 
 void Lexer::skipWhitespace() {
-    while (!isAtEnd() && std::isspace(input[pos])) {
+    // Most gaps are a single space; only longer runs go to the scan kernel.
+    if (pos < input.size() && hasClass(input[pos], CC_SPACE)) {
         pos++;
+        if (pos < input.size() && hasClass(input[pos], CC_SPACE)) {
+            pos = scan->skipSpace(input.data(), pos + 1, input.size());
+        }
     }
 }
 
@@ -124,35 +180,35 @@ bool Lexer::isAtEnd() {
 }
 
 
-void Lexer::printTokens() {
+void Lexer::printTokens(std::ostream& out) const {
     for (size_t i = 0; i < tokens.size(); i++) {
-        Token t = tokens[i];
-        std::cout << "Token[" << i << "]: ";
+        const Token& t = tokens[i];
+        out << "Token[" << i << "]: ";
         
        
         switch (t.type) {
-            case TOK_INT: std::cout << "INT"; break;
-            case TOK_IF: std::cout << "IF"; break;
-            case TOK_ELSE: std::cout << "ELSE"; break; 
-            case TOK_ID: std::cout << "ID"; break;
-            case TOK_NUM: std::cout << "NUM"; break;
-            case TOK_ASSIGN: std::cout << "ASSIGN"; break;
-            case TOK_PLUS: std::cout << "PLUS"; break;
-            case TOK_MINUS: std::cout << "MINUS"; break;
-            case TOK_EQ: std::cout << "EQ"; break;
-            case TOK_LBRACE: std::cout << "LBRACE"; break;
-            case TOK_RBRACE: std::cout << "RBRACE"; break;
-            case TOK_LPAREN: std::cout << "LPAREN"; break;
-            case TOK_RPAREN: std::cout << "RPAREN"; break;
-            case TOK_SEMI: std::cout << "SEMI"; break;
-            case TOK_EOF: std::cout << "EOF"; break;
-            default: std::cout << "UNKNOWN"; break;
+            case TOK_INT: out << "INT"; break;
+            case TOK_IF: out << "IF"; break;
+            case TOK_ELSE: out << "ELSE"; break; 
+            case TOK_ID: out << "ID"; break;
+            case TOK_NUM: out << "NUM"; break;
+            case TOK_ASSIGN: out << "ASSIGN"; break;
+            case TOK_PLUS: out << "PLUS"; break;
+            case TOK_MINUS: out << "MINUS"; break;
+            case TOK_EQ: out << "EQ"; break;
+            case TOK_LBRACE: out << "LBRACE"; break;
+            case TOK_RBRACE: out << "RBRACE"; break;
+            case TOK_LPAREN: out << "LPAREN"; break;
+            case TOK_RPAREN: out << "RPAREN"; break;
+            case TOK_SEMI: out << "SEMI"; break;
+            case TOK_EOF: out << "EOF"; break;
+            default: out << "UNKNOWN"; break;
         }
         
         
-        if (t.value != "") {
-            std::cout << " (" << t.value << ")";
+        if (!t.text.empty()) {
+            out << " (" << t.text << ")";
         }
-        std::cout << std::endl;
+        out << "\n";
     }
 }
@@ -0,0 +1,185 @@
+#include "lexer_scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SLC_SCAN_X86 1
+#endif
+
+
+namespace {
+
+template <uint8_t Cls>
+size_t scalarSkip(const char* text, size_t pos, size_t end) {
+    while (pos < end && (charClasses[static_cast<unsigned char>(text[pos])] & Cls)) {
+        pos++;
+    }
+    return pos;
+}
+
+size_t scalarFindDelim(const char* text, size_t pos, size_t end) {
+    while (pos < end && !(charClasses[static_cast<unsigned char>(text[pos])] & CC_DELIM)) {
+        pos++;
+    }
+    return pos;
+}
+
+const ScanKernels scalarKernels = {
+    "scalar", scalarSkip<CC_SPACE>, scalarSkip<CC_IDENT>, scalarSkip<CC_DIGIT>, scalarFindDelim,
+};
+
+#if defined(SLC_SCAN_X86) && defined(__SSE2__)
+
+// Range tests use one unsigned compare: c is in [lo, lo + width] exactly when
+// (c - lo) mod 256 <= width, and x <= width exactly when min(x, width) == x.
+inline __m128i sse2InRange(__m128i v, char lo, char width) {
+    __m128i x = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(width)), x);
+}
+
+// 0xFF in every byte lane that belongs to class Cls.
+template <uint8_t Cls>
+inline __m128i sse2Classify(__m128i v) {
+    if constexpr (Cls == CC_SPACE) {
+        return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), sse2InRange(v, '\t', 4));
+    } else if constexpr (Cls == CC_DIGIT) {
+        return sse2InRange(v, '0', 9);
+    } else if constexpr (Cls == CC_DELIM) {
+        return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('{')), _mm_cmpeq_epi8(v, _mm_set1_epi8('}'))),
+                            _mm_cmpeq_epi8(v, _mm_set1_epi8(';')));
+    } else {
+        // Setting bit 5 folds 'A'-'Z' onto 'a'-'z' and nothing else onto them.
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i letter = sse2InRange(lower, 'a', 25);
+        __m128i digitOrUnderscore = _mm_or_si128(sse2InRange(v, '0', 9), _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+        return _mm_or_si128(letter, digitOrUnderscore);
+    }
+}
+
+template <uint8_t Cls>
+size_t sse2Skip(const char* text, size_t pos, size_t end) {
+    while (pos + 16 <= end) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos));
+        unsigned outside = ~static_cast<unsigned>(_mm_movemask_epi8(sse2Classify<Cls>(v))) & 0xFFFFu;
+        if (outside) return pos + __builtin_ctz(outside);
+        pos += 16;
+    }
+    return scalarSkip<Cls>(text, pos, end);
+}
+
+size_t sse2FindDelim(const char* text, size_t pos, size_t end) {
+    while (pos + 16 <= end) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos));
+        unsigned inside = static_cast<unsigned>(_mm_movemask_epi8(sse2Classify<CC_DELIM>(v)));
+        if (inside) return pos + __builtin_ctz(inside);
+        pos += 16;
+    }
+    return scalarFindDelim(text, pos, end);
+}
+
+const ScanKernels sse2Kernels = {
+    "sse2", sse2Skip<CC_SPACE>, sse2Skip<CC_IDENT>, sse2Skip<CC_DIGIT>, sse2FindDelim,
+};
+
+#endif
+
+#if defined(SLC_SCAN_X86)
+
+#define SLC_AVX2 __attribute__((target("avx2")))
+
+SLC_AVX2 inline __m256i avx2InRange(__m256i v, char lo, char width) {
+    __m256i x = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(width)), x);
+}
+
+template <uint8_t Cls>
+SLC_AVX2 inline __m256i avx2Classify(__m256i v) {
+    if constexpr (Cls == CC_SPACE) {
+        return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), avx2InRange(v, '\t', 4));
+    } else if constexpr (Cls == CC_DIGIT) {
+        return avx2InRange(v, '0', 9);
+    } else if constexpr (Cls == CC_DELIM) {
+        return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('{')),
+                                               _mm256_cmpeq_epi8(v, _mm256_set1_epi8('}'))),
+                               _mm256_cmpeq_epi8(v, _mm256_set1_epi8(';')));
+    } else {
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i letter = avx2InRange(lower, 'a', 25);
+        __m256i digitOrUnderscore = _mm256_or_si256(avx2InRange(v, '0', 9),
+                                                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+        return _mm256_or_si256(letter, digitOrUnderscore);
+    }
+}
+
+template <uint8_t Cls>
+SLC_AVX2 size_t avx2Skip(const char* text, size_t pos, size_t end) {
+    while (pos + 32 <= end) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + pos));
+        unsigned outside = ~static_cast<unsigned>(_mm256_movemask_epi8(avx2Classify<Cls>(v)));
+        if (outside) return pos + __builtin_ctz(outside);
+        pos += 32;
+    }
+    return scalarSkip<Cls>(text, pos, end);
+}
+
+SLC_AVX2 size_t avx2FindDelim(const char* text, size_t pos, size_t end) {
+    while (pos + 32 <= end) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + pos));
+        unsigned inside = static_cast<unsigned>(_mm256_movemask_epi8(avx2Classify<CC_DELIM>(v)));
+        if (inside) return pos + __builtin_ctz(inside);
+        pos += 32;
+    }
+    return scalarFindDelim(text, pos, end);
+}
+
+const ScanKernels avx2Kernels = {
+    "avx2", avx2Skip<CC_SPACE>, avx2Skip<CC_IDENT>, avx2Skip<CC_DIGIT>, avx2FindDelim,
+};
+
+#undef SLC_AVX2
+
+#endif
+
+const ScanKernels* bestKernels() {
+#if defined(SLC_SCAN_X86)
+    if (__builtin_cpu_supports("avx2")) return &avx2Kernels;
+#endif
+#if defined(SLC_SCAN_X86) && defined(__SSE2__)
+    return &sse2Kernels;
+#else
+    return &scalarKernels;
+#endif
+}
+
+const ScanKernels* selected = nullptr;
+
+}
+
+
+const ScanKernels& scanKernels() {
+    static const ScanKernels* const best = bestKernels();
+    return selected ? *selected : *best;
+}
+
+bool selectScanKernels(std::string_view name) {
+    if (name == "auto") {
+        selected = bestKernels();
+        return true;
+    }
+    if (name == "scalar") {
+        selected = &scalarKernels;
+        return true;
+    }
+#if defined(SLC_SCAN_X86) && defined(__SSE2__)
+    if (name == "sse2") {
+        selected = &sse2Kernels;
+        return true;
+    }
+#endif
+#if defined(SLC_SCAN_X86)
+    if (name == "avx2" && __builtin_cpu_supports("avx2")) {
+        selected = &avx2Kernels;
+        return true;
+    }
+#endif
+    return false;
+}
@@ -1,57 +1,86 @@
-#include "lexer.h"
-#include "parser.h"
-#include "ast.h"
+#include "driver.h"
+#include "cache.h"
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+static void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [options] <source-file> <outfile.asm>\n"
+              << "       " << argv0 << " --run <file.asm|file.bin> [--max-steps=N]\n"
+              << "       " << argv0 << " --assemble <file.asm> <file.bin>\n"
+              << "       " << argv0 << " --batch [options] [-j N] [--out-dir=DIR] <source-file|@manifest>...\n"
+              << "Options:\n"
+              << "  -O0 | -O1                disable / enable (default) optimization passes\n"
+              << "  --no-dce                 keep dead stores and unreachable branches\n"
+              << "  --no-peephole            skip the peephole pass over the generated code\n"
+              << "  --peephole=RULE,...      run only these rules: store-reload, redundant-load,\n"
+              << "                           duplicate-store, jump-to-next\n"
+              << "  --peephole-window=N      instructions each rule may look back over (default 8)\n"
+              << "  --target=abm|x86_64      A/B/M accumulator code (default) or x86-64 assembly\n"
+              << "  --emit=asm|bin           write assembly text (default) or an encoded image\n"
+              << "  --dump-tokens            print every token before parsing\n"
+              << "  --dump-ast               print the AST after the AST passes\n"
+              << "  --dump-ir-after=PASS     print the IR after PASS (or after \"lower\")\n"
+              << "  --time-report[=json]     print time, allocations and peak RSS per phase\n"
+              << "                           to stderr, as a table or as JSON\n"
+              << "  --lexer-scan=KIND        auto (default), avx2, sse2 or scalar lexer scanning\n"
+              << "  --flat-ast               use the flat AST for printing and code generation\n"
+              << "  -j N | --jobs=N          threads for a batch, or for one large file\n"
+              << "                           (default: one per hardware thread)\n"
+              << "  --cache-dir=DIR          reuse generated code for unchanged sources\n"
+              << "  --cache-max-size=N[KMG]  evict least recently used entries beyond N bytes\n";
+}
 
 int main(int argc, char* argv[]) {
-    if (argc < 3) {
-        std::cerr << "Usage: " << argv[0] << " <source-file> <outfile.asm>\n";
-        return 1;
+    Options opts;
+    std::string error;
+    bool parsed;
+    try {
+        parsed = parseOptions(argc, argv, opts, error);
+    } catch (const std::exception&) {
+        parsed = false;
+        error = "Invalid option value";
     }
-
-    // Read source file
-    std::ifstream file(argv[1]);
-    if (!file.is_open()) {
-        std::cerr << "Error: Could not open file " << argv[1] << "\n";
+    if (!parsed) {
+        std::cerr << "Error: " << error << "\n";
+        usage(argv[0]);
         return 1;
     }
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string program = buffer.str();
-
-    std::cout << "=== SimpleLang Compiler Test ===\n";
-    std::cout << "Input program: " << program << "\n\n";
 
-    // Step 1: Lexical analysis
-    std::cout << "=== Lexer Output ===\n";
-    Lexer lexer(program);
-    lexer.tokenize();
-    lexer.printTokens();
-
-    // Step 2: Syntax analysis - now returns single Program node
-    std::cout << "\n=== Parser Output ===\n";
-    Parser parser(lexer.getTokens());
-    auto programNode = parser.parse();
+    if (!opts.runPath.empty()) {
+        return runSimulator(opts);
+    }
+    if (opts.assemble) {
+        return runAssembler(opts);
+    }
+    if (opts.batch) {
+        return runBatch(opts);
+    }
 
-    std::cout << "Successfully parsed program with " 
-              << programNode->statements.size() << " statements\n\n";
+    if (opts.inputs.size() < 2) {
+        usage(argv[0]);
+        return 1;
+    }
 
-    // Step 3: AST visualization
-    std::cout << "=== Abstract Syntax Tree ===\n";
-    PrintVisitor printer;
-    programNode->accept(&printer);
+    std::unique_ptr<CompileCache> cache;
+    if (!opts.cacheDir.empty()) {
+        cache = std::make_unique<CompileCache>(opts.cacheDir, opts.cacheMaxBytes);
+    }
 
-    std::string outfile = argv[2];
-    std::ofstream out_f(outfile);
-    out_f << ".text" << std::endl;
-    // Step 4: Code generation
-    std::cout << "\n=== Generated Code ===\n";
-    programNode->gencode(out_f);
-    out_f << "hlt" << std::endl;
+    CompileResult result = compileFile(opts, opts.inputs[0], opts.inputs[1], &std::cout, cache.get());
+    if (cache) {
+        std::cout << "Cache: " << cache->hits() << " hits, " << cache->misses() << " misses, "
+                  << cache->evictions() << " evicted\n";
+    }
+    if (!opts.timeReport.empty()) {
+        printTimeReport(std::cerr, result.phases, opts.timeReport == "json");
+    }
+    if (!result.ok) {
+        std::cerr << "Error: " << result.error << "\n";
+        return 1;
+    }
 
-    std::cout << "\nCompilation completed successfully!\n";
+    std::cout << "Compilation completed successfully!\n";
     return 0;
 }
-
@@ -0,0 +1,47 @@
+#include "mapped_file.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+MappedFile::~MappedFile() {
+    if (mapped) {
+        munmap(const_cast<char*>(base), length);
+    }
+}
+
+bool MappedFile::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            // The lexer makes one front-to-back pass over the source.
+            madvise(p, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+            ::close(fd);
+            base = static_cast<const char*>(p);
+            length = static_cast<size_t>(st.st_size);
+            mapped = true;
+            return true;
+        }
+    }
+
+    char chunk[65536];
+    ssize_t n;
+    while ((n = ::read(fd, chunk, sizeof(chunk))) != 0) {
+        if (n < 0) {
+            ::close(fd);
+            return false;
+        }
+        contents.append(chunk, static_cast<size_t>(n));
+    }
+    ::close(fd);
+    base = contents.data();
+    length = contents.size();
+    return true;
+}
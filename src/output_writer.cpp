@@ -0,0 +1,115 @@
+#include "output_writer.h"
+#include <cerrno>
+#include <algorithm>
+#include <climits>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+
+
+OutputWriter::OutputWriter(size_t capacity)
+    : fd(-1), buf(new char[capacity]), capacity(capacity), used(0),
+      writeCalls(0), written(0), failed(false) {
+}
+
+OutputWriter::~OutputWriter() {
+    close();
+}
+
+bool OutputWriter::open(const std::string& path) {
+    close();
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    used = 0;
+    writeCalls = 0;
+    written = 0;
+    failed = fd < 0;
+    return fd >= 0;
+}
+
+bool OutputWriter::close() {
+    if (fd < 0) {
+        return !failed;
+    }
+    flush();
+    if (::close(fd) != 0) failed = true;
+    fd = -1;
+    return !failed;
+}
+
+void OutputWriter::flush() {
+    if (fd < 0) {
+        grow(used + 1);
+        return;
+    }
+    writeAll(buf.get(), used);
+    used = 0;
+}
+
+void OutputWriter::grow(size_t needed) {
+    if (needed <= capacity) return;
+    size_t bigger = std::max(needed, 2 * capacity);
+    std::unique_ptr<char[]> next(new char[bigger]);
+    std::memcpy(next.get(), buf.get(), used);
+    buf = std::move(next);
+    capacity = bigger;
+}
+
+void OutputWriter::writeAll(const char* data, size_t size) {
+    if (fd < 0) {
+        grow(used + size);
+        std::memcpy(buf.get() + used, data, size);
+        used += size;
+        return;
+    }
+    while (size > 0 && !failed) {
+        ssize_t n = ::write(fd, data, size);
+        writeCalls++;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            failed = true;
+            break;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+        written += static_cast<uint64_t>(n);
+    }
+}
+
+void OutputWriter::writeParts(const std::string_view* parts, size_t count) {
+    if (fd < 0) {
+        for (size_t i = 0; i < count; i++) writeAll(parts[i].data(), parts[i].size());
+        return;
+    }
+
+    std::vector<iovec> pieces;
+    pieces.reserve(count + 1);
+    if (used > 0) pieces.push_back({buf.get(), used});
+    for (size_t i = 0; i < count; i++) {
+        if (!parts[i].empty()) pieces.push_back({const_cast<char*>(parts[i].data()), parts[i].size()});
+    }
+    used = 0;
+
+    // A short write leaves `first` pointing into the piece it stopped in.
+    size_t first = 0;
+    while (first < pieces.size() && !failed) {
+        int batch = static_cast<int>(std::min<size_t>(pieces.size() - first, IOV_MAX));
+        ssize_t n = ::writev(fd, pieces.data() + first, batch);
+        writeCalls++;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            failed = true;
+            break;
+        }
+        written += static_cast<uint64_t>(n);
+        size_t left = static_cast<size_t>(n);
+        while (first < pieces.size() && left >= pieces[first].iov_len) {
+            left -= pieces[first].iov_len;
+            first++;
+        }
+        if (left > 0) {
+            pieces[first].iov_base = static_cast<char*>(pieces[first].iov_base) + left;
+            pieces[first].iov_len -= left;
+        }
+    }
+}
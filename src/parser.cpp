@@ -1,21 +1,53 @@
 #include "parser.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <mutex>
 #include <stdexcept>
+#include <unordered_map>
 
 
-Parser::Parser(std::vector<Token> toks) {
-    tokens = toks;
-    current = 0;
+Parser::Parser(Lexer& lex, CompilationContext& ctx)
+    : lexer(&lex), tokens(nullptr), tokenCount(0), nextIndex(0), head(0), buffered(0),
+      arena(nullptr), ctx(ctx) {
+}
+
+Parser::Parser(const std::vector<Token>& toks, CompilationContext& ctx)
+    : lexer(nullptr), tokens(toks.data()), tokenCount(toks.size()), nextIndex(0), head(0), buffered(0),
+      arena(nullptr), ctx(ctx) {
 }
 
 
+Token Parser::fetch() {
+    if (lexer) {
+        return lexer->next();
+    }
+    if (nextIndex < tokenCount) {
+        return tokens[nextIndex++];
+    }
+    return Token(TOK_EOF, std::string_view());
+}
+
+const Token& Parser::peek(size_t k) {
+    if (k >= LOOKAHEAD) {
+        throw std::runtime_error("Parser lookahead exceeds window size");
+    }
+    while (buffered <= k) {
+        window[(head + buffered) % LOOKAHEAD] = fetch();
+        buffered++;
+    }
+    return window[(head + k) % LOOKAHEAD];
+}
+
 bool Parser::isEnd() {
-    return current >= tokens.size() || tokens[current].type == TOK_EOF;
+    return peek().type == TOK_EOF;
 }
 
 bool Parser::match(TokenType type) {
     if (isEnd()) return false;
-    return tokens[current].type == type;
+    return peek().type == type;
 }
 
 void Parser::expect(TokenType type) {
@@ -27,182 +59,423 @@ void Parser::expect(TokenType type) {
 
 void Parser::advance() {
     if (!isEnd()) {
-        current++;
+        head = (head + 1) % LOOKAHEAD;
+        buffered--;
     }
 }
 
 
+// Copies the current token's text into the arena and consumes the token.
+std::string_view Parser::takeText() {
+    std::string_view text = arena->copyString(peek().text);
+    advance();
+    return text;
+}
+
+uint32_t Parser::takeSymbol() {
+    uint32_t sym = ctx.symbols.intern(peek().text);
+    advance();
+    return sym;
+}
+
+NodeList Parser::finishList(size_t mark) {
+    NodeList list;
+    list.count = static_cast<uint32_t>(scratch.size() - mark);
+    list.items = arena->copyArray(scratch.data() + mark, list.count);
+    scratch.resize(mark);
+    return list;
+}
+
+
 std::unique_ptr<Program> Parser::parse() {
     auto program = std::make_unique<Program>();
-    
-  
-    while (!isEnd()) {
-        auto stmt = parseStatement();
-        if (stmt) {
-            program->addStatement(std::move(stmt));
+    arena = &program->arena;
+    size_t mark = scratch.size();
+    blocks.clear();
+
+
+    while (true) {
+        if (!blocks.empty() && (match(TOK_RBRACE) || isEnd())) {
+            if (closeBlock()) {
+                scratch.push_back(blocks.back().node);
+                blocks.pop_back();
+            }
+        } else if (isEnd()) {
+            break;
+        } else if (match(TOK_IF)) {
+            blocks.push_back({parseIfHead(), scratch.size(), false});
+        } else {
+            ASTNode* stmt = parseStatement();
+            if (stmt) {
+                scratch.push_back(stmt);
+            }
         }
     }
-    
+
+    program->statements = finishList(mark);
     return program;
 }
 
-// now handles "int a = 4;"
-std::unique_ptr<ASTNode> Parser::parseStatement() {
+// Ends the innermost open body at its '}'. Returns true once the if is
+// complete, false if an else-body has just been opened.
+bool Parser::closeBlock() {
+    OpenBlock& block = blocks.back();
+    NodeList body = finishList(block.mark);
+    expect(TOK_RBRACE);
+
+    if (block.inElse) {
+        block.node->elseBody = body;
+        return true;
+    }
+    block.node->thenBody = body;
+    if (!match(TOK_ELSE)) {
+        return true;
+    }
+    advance();
+    expect(TOK_LBRACE);
+    block.inElse = true;
+    block.mark = scratch.size();
+    return false;
+}
+
+// Parses any statement except an if, which parse() opens and closes itself.
+ASTNode* Parser::parseStatement() {
     if (match(TOK_INT)) {
-       
-        int savedPos = current;
-        advance(); 
-        
-        if (match(TOK_ID)) {
-            advance();
-            if (match(TOK_ASSIGN)) {
-                current = savedPos;
-                return parseVarDeclAssign();
-            } else {
-                current = savedPos;
-                return parseVarDecl();
-            }
-        } else {
-            current = savedPos;
-            return parseVarDecl();
+
+        if (peek(1).type == TOK_ID && peek(2).type == TOK_ASSIGN) {
+            return parseVarDeclAssign();
         }
-    }
-    else if (match(TOK_IF)) {
-        return parseIfStmt();
+        return parseVarDecl();
     }
     else if (match(TOK_ID)) {
         return parseAssignment();
     }
     else {
-        advance(); 
+        advance();
         return nullptr;
     }
 }
 
-std::unique_ptr<VarDecl> Parser::parseVarDecl() {
+VarDecl* Parser::parseVarDecl() {
     expect(TOK_INT);
-    
+
     if (!match(TOK_ID)) {
         throw std::runtime_error("Expected identifier after 'int'");
     }
-    
-    std::string varName = tokens[current].value;
-    advance();
+
+    uint32_t sym = takeSymbol();
     expect(TOK_SEMI);
-    
-    return std::make_unique<VarDecl>(varName);
+
+    return arena->make<VarDecl>(sym);
 }
 
-std::unique_ptr<VarDeclAssign> Parser::parseVarDeclAssign() {
+VarDeclAssign* Parser::parseVarDeclAssign() {
     expect(TOK_INT);
-    
+
     if (!match(TOK_ID)) {
         throw std::runtime_error("Expected identifier after 'int'");
     }
-    
-    std::string varName = tokens[current].value;
-    advance();
+
+    uint32_t sym = takeSymbol();
     expect(TOK_ASSIGN);
-    
-    auto expr = parseExpression();
+
+    Expression* expr = parseExpression();
     expect(TOK_SEMI);
-    
-    return std::make_unique<VarDeclAssign>(varName, std::move(expr));
+
+    return arena->make<VarDeclAssign>(sym, expr);
 }
 
-std::unique_ptr<AssignStmt> Parser::parseAssignment() {
-    std::string varName = tokens[current].value;
-    advance();
+AssignStmt* Parser::parseAssignment() {
+    uint32_t sym = takeSymbol();
     expect(TOK_ASSIGN);
-    
-    auto expr = parseExpression();
+
+    Expression* expr = parseExpression();
     expect(TOK_SEMI);
-    
-    return std::make_unique<AssignStmt>(varName, std::move(expr));
+
+    return arena->make<AssignStmt>(sym, expr);
 }
 
-std::unique_ptr<IfStmt> Parser::parseIfStmt() {
+// Parses "if (cond) {"; the bodies are filled in by closeBlock().
+IfStmt* Parser::parseIfHead() {
     expect(TOK_IF);
     expect(TOK_LPAREN);
-    
-    auto condition = parseExpression();
-    
+
+    Expression* condition = parseExpression();
+
     expect(TOK_RPAREN);
     expect(TOK_LBRACE);
-    
-    auto ifStmt = std::make_unique<IfStmt>(std::move(condition));
-    
-  
-    while (!match(TOK_RBRACE) && !isEnd()) {
-        auto stmt = parseStatement();
-        if (stmt) {
-            ifStmt->thenBody.push_back(std::move(stmt));
+
+    return arena->make<IfStmt>(condition);
+}
+
+// expression := sum ('==' sum)?
+// sum        := primary (('+' | '-') primary)*
+// primary    := NUM | ID | '(' expression ')'
+//
+// Each '(' opens a frame on `exprs`; an operand is folded into the innermost
+// frame as soon as it is complete, which builds the same left-associative
+// trees as a recursive descent would.
+Expression* Parser::parseExpression() {
+    exprs.clear();
+    exprs.push_back({});
+
+    while (true) {
+        while (match(TOK_LPAREN)) {
+            advance();
+            exprs.push_back({});
         }
-    }
-    
-    expect(TOK_RBRACE);
-    
-   
-    if (match(TOK_ELSE)) {
-        advance();
-        expect(TOK_LBRACE);
-        
-     
-        while (!match(TOK_RBRACE) && !isEnd()) {
-            auto stmt = parseStatement();
-            if (stmt) {
-                ifStmt->elseBody.push_back(std::move(stmt));
+        Expression* operand = parsePrimary();
+
+        while (true) {
+            OpenExpr& open = exprs.back();
+            open.sum = open.sum ? arena->make<BinaryExpr>(open.sum, open.sumOp, operand) : operand;
+
+            if (match(TOK_PLUS) || match(TOK_MINUS)) {
+                open.sumOp = takeText();
+                break;
             }
+            if (match(TOK_EQ) && !open.cmpLeft) {
+                open.cmpLeft = open.sum;
+                open.cmpOp = takeText();
+                open.sum = nullptr;
+                break;
+            }
+
+            operand = finishExpr();
+            if (exprs.empty()) {
+                return operand;
+            }
+            expect(TOK_RPAREN);
         }
-        
-        expect(TOK_RBRACE);
     }
-    
-    return ifStmt;
 }
 
-std::unique_ptr<Expression> Parser::parseExpression() {
-    return parseComparison();
+// Pops the innermost frame and returns the expression it built.
+Expression* Parser::finishExpr() {
+    OpenExpr open = exprs.back();
+    exprs.pop_back();
+    if (open.cmpLeft) {
+        return arena->make<BinaryExpr>(open.cmpLeft, open.cmpOp, open.sum);
+    }
+    return open.sum;
 }
 
-std::unique_ptr<Expression> Parser::parseComparison() {
-    auto expr = parseAddition();
-    
-    if (match(TOK_EQ)) {
-        std::string op = tokens[current].value;
+Expression* Parser::parsePrimary() {
+    if (match(TOK_NUM)) {
+        int value = peek().value;
         advance();
-        auto right = parseAddition();
-        expr = std::make_unique<BinaryExpr>(std::move(expr), op, std::move(right));
+        return arena->make<NumberLiteral>(value);
+    }
+    else if (match(TOK_ID)) {
+        return arena->make<Identifier>(takeSymbol());
+    }
+    else {
+        throw std::runtime_error("Expected number or identifier");
     }
-    
-    return expr;
 }
 
-std::unique_ptr<Expression> Parser::parseAddition() {
-    auto expr = parsePrimary();
-    
-    while (match(TOK_PLUS) || match(TOK_MINUS)) {
-        std::string op = tokens[current].value;
-        advance();
-        auto right = parsePrimary();
-        expr = std::make_unique<BinaryExpr>(std::move(expr), op, std::move(right));
+
+namespace {
+
+// Parallel chunks are at least this large, so each task outweighs its setup.
+const size_t MIN_CHUNK_BYTES = 256 * 1024;
+
+bool followedByElse(std::string_view source, size_t pos) {
+    while (pos < source.size() && hasClass(source[pos], CC_SPACE)) {
+        pos++;
     }
-    
-    return expr;
+    return source.substr(pos, 4) == "else" &&
+           (pos + 4 == source.size() || !hasClass(source[pos + 4], CC_IDENT));
 }
 
-std::unique_ptr<Expression> Parser::parsePrimary() {
-    if (match(TOK_NUM)) {
-        int value = std::stoi(tokens[current].value);
-        advance();
-        return std::make_unique<NumberLiteral>(value);
+// Every name any chunk interned, with the earliest place it appears as
+// (chunk << 32 | ID within the chunk). Names are spread over independently
+// locked shards so that chunks can record theirs concurrently. Entries never
+// move once inserted, so after the inserts are done their addresses can be
+// kept and read without locking.
+class FirstAppearances {
+public:
+    struct Entry {
+        uint64_t first;
+        uint32_t id = 0;        // ID in the merged table, once assigned
+    };
+
+private:
+    static const size_t SHARDS = 64;
+
+    struct Shard {
+        std::mutex lock;
+        std::unordered_map<std::string_view, Entry> names;
+    };
+    Shard shards[SHARDS];
+
+    Shard& shard(std::string_view name) {
+        return shards[std::hash<std::string_view>()(name) % SHARDS];
     }
-    else if (match(TOK_ID)) {
-        std::string name = tokens[current].value;
-        advance();
-        return std::make_unique<Identifier>(name);
+
+public:
+    void note(std::string_view name, uint64_t where) {
+        Shard& s = shard(name);
+        std::lock_guard<std::mutex> guard(s.lock);
+        auto [it, inserted] = s.names.try_emplace(name, Entry{where});
+        if (!inserted) it->second.first = std::min(it->second.first, where);
     }
-    else {
-        throw std::runtime_error("Expected number or identifier");
+
+    Entry* find(std::string_view name) {
+        Shard& s = shard(name);
+        return &s.names.find(name)->second;
     }
+};
+
+// Rewrites the symbol IDs of a chunk parsed with its own SymbolTable into
+// IDs of the merged table.
+struct SymbolRemap {
+    const std::vector<uint32_t>& ids;
+    TreeWalker walker;
+
+    void statement(VarDecl* node) {
+        node->sym = ids[node->sym];
+    }
+
+    void statement(VarDeclAssign* node) {
+        node->sym = ids[node->sym];
+        walker.expression(node->expr, *this);
+    }
+
+    void statement(AssignStmt* node) {
+        node->sym = ids[node->sym];
+        walker.expression(node->expr, *this);
+    }
+
+    void beginIf(IfStmt* node) { walker.expression(node->condition, *this); }
+    void elseIf(IfStmt*) {}
+    void endIf(IfStmt*) {}
+
+    void leaf(Identifier* node) { node->sym = ids[node->sym]; }
+    void leaf(NumberLiteral*) {}
+    void binary(BinaryExpr*) {}
+};
+
+}
+
+
+// No token of the language contains '{', '}' or ';', so a byte scan finds
+// exactly the braces and semicolons the lexer would; the lexer's findDelim
+// kernel jumps from one to the next. Once the last cut has been made the
+// rest of the source is not scanned at all.
+std::vector<SourceChunk> splitTopLevel(std::string_view source, size_t chunks, size_t minBytes) {
+    std::vector<SourceChunk> result;
+    const ScanKernels& scan = scanKernels();
+    size_t target = std::max(minBytes, source.size() / std::max<size_t>(chunks, 1));
+    size_t begin = 0;
+    size_t depth = 0;
+
+    for (size_t i = 0; result.size() + 1 < chunks; i++) {
+        i = scan.findDelim(source.data(), i, source.size());
+        if (i == source.size()) break;
+        char c = source[i];
+        bool boundary;
+        if (c == '{') {
+            depth++;
+            continue;
+        } else if (c == '}') {
+            // A stray '}' at the top level is skipped by the parser.
+            if (depth > 0) depth--;
+            boundary = depth == 0;
+        } else {
+            boundary = c == ';' && depth == 0;
+        }
+
+        if (!boundary || i + 1 - begin < target) continue;
+        if (c == '}' && followedByElse(source, i + 1)) continue;
+        result.push_back({begin, i + 1});
+        begin = i + 1;
+    }
+
+    result.push_back({begin, source.size()});
+    return result;
+}
+
+std::unique_ptr<Program> parseParallel(std::string_view source, CompilationContext& ctx, ThreadPool& pool) {
+    std::vector<SourceChunk> chunks = splitTopLevel(source, 4 * pool.size(), MIN_CHUNK_BYTES);
+    if (chunks.size() == 1) {
+        Lexer lexer(source);
+        return Parser(lexer, ctx).parse();
+    }
+
+    struct ChunkParse {
+        CompilationContext ctx;
+        std::unique_ptr<Program> program;
+        std::exception_ptr error;
+        std::vector<FirstAppearances::Entry*> entries;    // by chunk-local ID
+        std::vector<uint32_t> firsts;       // local IDs of names first seen here
+        std::vector<uint32_t> ids;          // chunk-local ID -> merged ID
+    };
+    std::vector<ChunkParse> parts(chunks.size());
+    FirstAppearances appearances;
+
+    // Each lexer sees the source up to the end of its chunk, so error line
+    // numbers count from the start of the file.
+    for (size_t i = 0; i < chunks.size(); i++) {
+        pool.submit([&, i] {
+            try {
+                Lexer lexer(source.substr(0, chunks[i].end), chunks[i].begin);
+                parts[i].program = Parser(lexer, parts[i].ctx).parse();
+            } catch (...) {
+                parts[i].error = std::current_exception();
+                return;
+            }
+            const SymbolTable& local = parts[i].ctx.symbols;
+            for (uint32_t id = 0; id < local.size(); id++) {
+                appearances.note(local.name(id), uint64_t(i) << 32 | id);
+            }
+        });
+    }
+    pool.wait();
+    for (ChunkParse& part : parts) {
+        if (part.error) std::rethrow_exception(part.error);
+    }
+
+    for (size_t i = 0; i < parts.size(); i++) {
+        pool.submit([&, i] {
+            const SymbolTable& local = parts[i].ctx.symbols;
+            parts[i].entries.resize(local.size());
+            for (uint32_t id = 0; id < local.size(); id++) {
+                FirstAppearances::Entry* entry = appearances.find(local.name(id));
+                parts[i].entries[id] = entry;
+                if (entry->first == (uint64_t(i) << 32 | id)) parts[i].firsts.push_back(id);
+            }
+        });
+    }
+    pool.wait();
+
+    // A chunk's table numbers names by first appearance within the chunk, so
+    // taking the names each chunk saw first, chunk by chunk, gives the IDs a
+    // serial parse assigns. Only these distinct names are interned serially.
+    for (ChunkParse& part : parts) {
+        for (uint32_t id : part.firsts) {
+            part.entries[id]->id = ctx.symbols.intern(part.ctx.symbols.name(id));
+        }
+    }
+    for (ChunkParse& part : parts) {
+        pool.submit([&part] {
+            part.ids.resize(part.entries.size());
+            for (size_t id = 0; id < part.entries.size(); id++) {
+                part.ids[id] = part.entries[id]->id;
+            }
+            SymbolRemap remap{part.ids, {}};
+            remap.walker.statements(part.program->statements, remap);
+        });
+    }
+    pool.wait();
+
+    auto program = std::make_unique<Program>();
+    std::vector<ASTNode*> statements;
+    for (ChunkParse& part : parts) {
+        statements.insert(statements.end(), part.program->statements.begin(), part.program->statements.end());
+        program->arena.absorb(part.program->arena);
+    }
+    program->statements.count = static_cast<uint32_t>(statements.size());
+    program->statements.items = program->arena.copyArray(statements.data(), statements.size());
+    return program;
 }
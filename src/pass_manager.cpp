@@ -0,0 +1,76 @@
+#include "pass_manager.h"
+#include "phase_timer.h"
+#include <chrono>
+
+
+namespace {
+
+struct PassInfo {
+    const char* name;
+    IrPass run;
+};
+
+const PassInfo standardPasses[] = {
+    {"fold-branches", foldBranches},
+    {"thread-jumps", threadJumps},
+    {"remove-unreachable", removeUnreachable},
+};
+
+void dumpIr(const IrProgram& ir, const SymbolTable& symbols, const char* after, std::ostream& dump) {
+    dump << "=== IR after " << after << " ===\n";
+    printIr(ir, symbols, dump);
+}
+
+}
+
+
+void PassManager::add(const char* name, IrPass pass) {
+    Entry entry;
+    entry.name = name;
+    entry.run = pass;
+    passes.push_back(entry);
+}
+
+void PassManager::run(IrProgram& ir, const SymbolTable& symbols,
+                      const std::string& dumpAfter, std::ostream& dump,
+                      PhaseTimer* timer) {
+    if (dumpAfter == "lower") {
+        dumpIr(ir, symbols, "lower", dump);
+    }
+    for (Entry& pass : passes) {
+        if (timer) timer->begin(std::string("ir:") + pass.name);
+        auto start = std::chrono::steady_clock::now();
+        pass.changed = pass.run(ir);
+        pass.millis = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        if (timer) timer->end();
+        if (dumpAfter == pass.name) {
+            dumpIr(ir, symbols, pass.name, dump);
+        }
+    }
+}
+
+void PassManager::report(std::ostream& out) const {
+    out << "IR passes:";
+    if (passes.empty()) out << " none";
+    for (size_t i = 0; i < passes.size(); i++) {
+        out << (i ? ", " : " ") << passes[i].name << " " << passes[i].millis << " ms"
+            << (passes[i].changed ? " (changed)" : "");
+    }
+    out << "\n";
+}
+
+void addStandardPasses(PassManager& passes, int optLevel) {
+    if (optLevel < 1) return;
+    for (const PassInfo& pass : standardPasses) {
+        passes.add(pass.name, pass.run);
+    }
+}
+
+bool isIrPassName(const std::string& name) {
+    if (name == "lower") return true;
+    for (const PassInfo& pass : standardPasses) {
+        if (name == pass.name) return true;
+    }
+    return false;
+}
@@ -0,0 +1,160 @@
+#include "peephole.h"
+
+
+namespace {
+
+const char* const ruleNames[PH_RULE_COUNT] = {
+    "store-reload",
+    "redundant-load",
+    "duplicate-store",
+    "jump-to-next",
+};
+
+bool writesReg(const Instr& instr, char reg) {
+    switch (instr.op) {
+        case OP_LDI:
+        case OP_LOAD:
+            return instr.reg == reg;
+        case OP_MOV_BA:
+            return reg == 'B';
+        case OP_ADD:
+        case OP_SUB:
+            return reg == 'A';
+        default:
+            return false;
+    }
+}
+
+// Control can reach the instruction after these from somewhere else (a
+// label) or not at all (jmp, hlt), so nothing before them is known to hold.
+bool endsWindow(const Instr& instr) {
+    return instr.op == OP_LABEL || instr.op == OP_JMP || instr.op == OP_HLT;
+}
+
+class PeepholePass {
+public:
+    const PeepholeConfig& config;
+    PeepholeStats stats;
+    InstrList out;
+
+    PeepholePass(const PeepholeConfig& config) : config(config) {}
+
+    size_t windowStart() const {
+        return out.size() > config.window ? out.size() - config.window : 0;
+    }
+
+    bool storeReload(const Instr& instr) const {
+        if (instr.op != OP_LOAD || instr.reg != 'A' || out.empty()) return false;
+        const Instr& prev = out.back();
+        return prev.op == OP_STORE && prev.arg == instr.arg;
+    }
+
+    // Walks back to the last instruction that set the register. The load is
+    // redundant if that put the same value there and nothing since changed
+    // the memory cell it came from.
+    bool redundantLoad(const Instr& instr) const {
+        if (instr.op != OP_LDI && instr.op != OP_LOAD) return false;
+        for (size_t i = out.size(); i-- > windowStart();) {
+            const Instr& prev = out[i];
+            if (endsWindow(prev)) return false;
+            if (instr.op == OP_LOAD && prev.op == OP_STORE && prev.arg == instr.arg) {
+                // A now mirrors the cell; B may hold a stale copy of it.
+                return instr.reg == 'A';
+            }
+            if (writesReg(prev, instr.reg)) {
+                return prev.op == instr.op && prev.arg == instr.arg;
+            }
+        }
+        return false;
+    }
+
+    bool duplicateStore(const Instr& instr) const {
+        if (instr.op != OP_STORE) return false;
+        for (size_t i = out.size(); i-- > windowStart();) {
+            const Instr& prev = out[i];
+            if (endsWindow(prev) || writesReg(prev, 'A')) return false;
+            if (prev.op == OP_STORE && prev.arg == instr.arg) return true;
+        }
+        return false;
+    }
+
+    // Called after a label is appended: a jump to it that only other labels
+    // separate it from falls through to the same place anyway.
+    bool jumpToNext() {
+        const Instr& target = out.back();
+        for (size_t i = out.size() - 1; i-- > windowStart();) {
+            Instr& prev = out[i];
+            if (prev.op == OP_LABEL) continue;
+            if ((prev.op == OP_JMP || prev.op == OP_JNZ) && prev.sameLabel(target)) {
+                out.erase(out.begin() + i);
+                return true;
+            }
+            return false;
+        }
+        return false;
+    }
+
+    bool drop(int rule, bool matched) {
+        if (config.enabled[rule] && matched) {
+            stats.hits[rule]++;
+            return true;
+        }
+        return false;
+    }
+
+    void append(const Instr& instr) {
+        if (drop(PH_STORE_RELOAD, storeReload(instr)) ||
+            drop(PH_REDUNDANT_LOAD, redundantLoad(instr)) ||
+            drop(PH_DUPLICATE_STORE, duplicateStore(instr))) {
+            return;
+        }
+        out.push_back(instr);
+
+        if (instr.op == OP_LABEL && config.enabled[PH_JUMP_TO_NEXT]) {
+            while (jumpToNext()) {
+                stats.hits[PH_JUMP_TO_NEXT]++;
+            }
+        }
+    }
+};
+
+}
+
+
+const char* peepholeRuleName(int rule) {
+    return ruleNames[rule];
+}
+
+bool parsePeepholeRules(const std::string& list, PeepholeConfig& config, std::string& error) {
+    for (bool& on : config.enabled) on = false;
+
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        if (comma == std::string::npos) comma = list.size();
+        std::string name = list.substr(start, comma - start);
+        start = comma + 1;
+        if (name.empty()) continue;
+
+        int rule = 0;
+        while (rule < PH_RULE_COUNT && name != ruleNames[rule]) rule++;
+        if (rule == PH_RULE_COUNT) {
+            error = "Unknown peephole rule " + name;
+            return false;
+        }
+        config.enabled[rule] = true;
+    }
+    return true;
+}
+
+PeepholeStats runPeephole(InstrList& code, const PeepholeConfig& config) {
+    PeepholePass pass(config);
+    pass.stats.before = code.size();
+    pass.out.reserve(code.size());
+    for (const Instr& instr : code) {
+        pass.append(instr);
+    }
+    code.swap(pass.out);
+    pass.stats.after = code.size();
+    return pass.stats;
+}
@@ -0,0 +1,131 @@
+#include "phase_timer.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sys/resource.h>
+
+
+namespace {
+
+struct AllocCounter {
+    uint64_t calls;
+    uint64_t bytes;
+};
+
+// Constant-initialized, so touching it from operator new never allocates.
+thread_local AllocCounter allocCounter = {0, 0};
+
+}
+
+
+// Global allocation functions. Array and nothrow forms forward here in
+// libstdc++, and every delete form ends in free(), so these two cover all
+// allocations made through new.
+void* operator new(std::size_t size) {
+    allocCounter.calls++;
+    allocCounter.bytes += size;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+
+uint64_t threadAllocations() {
+    return allocCounter.calls;
+}
+
+uint64_t threadAllocatedBytes() {
+    return allocCounter.bytes;
+}
+
+long peakRssKb() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return usage.ru_maxrss;
+}
+
+void PhaseTimer::begin(std::string name) {
+    end();
+    PhaseStats phase;
+    phase.name = std::move(name);
+    list.push_back(std::move(phase));
+    open = true;
+    allocsAtStart = threadAllocations();
+    bytesAtStart = threadAllocatedBytes();
+    start = std::chrono::steady_clock::now();
+}
+
+void PhaseTimer::end() {
+    if (!open) return;
+    auto now = std::chrono::steady_clock::now();
+    PhaseStats& phase = list.back();
+    phase.millis = std::chrono::duration<double, std::milli>(now - start).count();
+    phase.allocations = threadAllocations() - allocsAtStart;
+    phase.allocatedBytes = threadAllocatedBytes() - bytesAtStart;
+    phase.peakRssKb = peakRssKb();
+    open = false;
+}
+
+void accumulatePhases(std::vector<PhaseStats>& totals, const std::vector<PhaseStats>& phases) {
+    for (const PhaseStats& phase : phases) {
+        auto it = std::find_if(totals.begin(), totals.end(),
+                               [&](const PhaseStats& t) { return t.name == phase.name; });
+        if (it == totals.end()) {
+            totals.push_back(phase);
+            continue;
+        }
+        it->millis += phase.millis;
+        it->allocations += phase.allocations;
+        it->allocatedBytes += phase.allocatedBytes;
+        it->peakRssKb = std::max(it->peakRssKb, phase.peakRssKb);
+    }
+}
+
+void printTimeReport(std::ostream& out, const std::vector<PhaseStats>& phases, bool json) {
+    PhaseStats total;
+    total.name = "total";
+    for (const PhaseStats& phase : phases) {
+        total.millis += phase.millis;
+        total.allocations += phase.allocations;
+        total.allocatedBytes += phase.allocatedBytes;
+        total.peakRssKb = std::max(total.peakRssKb, phase.peakRssKb);
+    }
+
+    char line[160];
+    if (json) {
+        out << "{\"phases\":[";
+        for (size_t i = 0; i <= phases.size(); i++) {
+            const PhaseStats& p = i < phases.size() ? phases[i] : total;
+            // Phase names are fixed identifiers, so they need no escaping.
+            std::snprintf(line, sizeof(line),
+                          "%s{\"name\":\"%s\",\"ms\":%.3f,\"allocs\":%llu,\"alloc_bytes\":%llu,\"peak_rss_kb\":%ld}",
+                          i ? "," : "", p.name.c_str(), p.millis, (unsigned long long)p.allocations,
+                          (unsigned long long)p.allocatedBytes, p.peakRssKb);
+            out << line;
+        }
+        out << "]}\n";
+        return;
+    }
+
+    out << "Time report:\n";
+    std::snprintf(line, sizeof(line), "  %-26s %10s %10s %12s %10s\n",
+                  "phase", "ms", "allocs", "bytes", "peak KiB");
+    out << line;
+    for (size_t i = 0; i <= phases.size(); i++) {
+        const PhaseStats& p = i < phases.size() ? phases[i] : total;
+        std::snprintf(line, sizeof(line), "  %-26s %10.3f %10llu %12llu %10ld\n",
+                      p.name.c_str(), p.millis, (unsigned long long)p.allocations,
+                      (unsigned long long)p.allocatedBytes, p.peakRssKb);
+        out << line;
+    }
+}
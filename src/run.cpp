@@ -0,0 +1,93 @@
+#include "driver.h"
+#include "encoding.h"
+#include "output_writer.h"
+#include "simulator.h"
+#include <fstream>
+#include <iterator>
+
+
+namespace {
+
+bool readBytes(const std::string& path, std::vector<uint8_t>& bytes) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// Reads assembly text or, if the file starts with the image magic, an image.
+bool loadProgram(const std::string& path, Arena& labels, InstrList& code, std::string& error) {
+    std::vector<uint8_t> bytes;
+    if (!readBytes(path, bytes)) {
+        error = "Could not open file " + path;
+        return false;
+    }
+    bool ok;
+    if (isImage(bytes)) {
+        ok = decodeProgram(bytes, labels, code, error);
+    } else {
+        std::string_view text(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        ok = parseProgram(text, labels, code, error);
+    }
+    if (!ok) error = path + ": " + error;
+    return ok;
+}
+
+}
+
+
+int runSimulator(const Options& opts) {
+    Arena labels(4096);
+    InstrList code;
+    std::string error;
+    if (!loadProgram(opts.runPath, labels, code, error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+
+    Simulator sim(code);
+    if (!sim.link(error)) {
+        std::cerr << "Error: " << opts.runPath << ": " << error << "\n";
+        return 1;
+    }
+    bool finished = sim.run(opts.maxSteps, error);
+
+    std::cout << "=== Simulation of " << opts.runPath << " ===\n";
+    sim.report(std::cout);
+    if (!finished) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+int runAssembler(const Options& opts) {
+    if (opts.inputs.size() < 2) {
+        std::cerr << "Error: --assemble needs <file.asm> <file.bin>\n";
+        return 1;
+    }
+
+    Arena labels(4096);
+    InstrList code;
+    std::string error;
+    std::vector<uint8_t> image;
+    if (!loadProgram(opts.inputs[0], labels, code, error) || !encodeProgram(code, image, error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+
+    OutputWriter out;
+    if (!out.open(opts.inputs[1])) {
+        std::cerr << "Error: Could not open output file " << opts.inputs[1] << "\n";
+        return 1;
+    }
+    out.write(reinterpret_cast<const char*>(image.data()), image.size());
+    if (!out.close()) {
+        std::cerr << "Error: Could not write output file " << opts.inputs[1] << "\n";
+        return 1;
+    }
+    std::cout << "Assembled " << code.size() << " instructions into " << image.size() << " bytes\n";
+    return 0;
+}
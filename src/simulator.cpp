@@ -0,0 +1,136 @@
+#include "simulator.h"
+#include <algorithm>
+#include <unordered_map>
+
+
+Simulator::Simulator(const InstrList& code) : code(code), target(code.size(), -1) {
+    int highest = 0;
+    for (const Instr& instr : code) {
+        if (instr.op == OP_LOAD || instr.op == OP_STORE) highest = std::max(highest, instr.arg);
+    }
+    memory.assign(static_cast<size_t>(highest) + 1, 0);
+    touched.assign(memory.size(), 0);
+}
+
+bool Simulator::link(std::string& error) {
+    for (const Instr& instr : code) {
+        if ((instr.op == OP_LOAD || instr.op == OP_STORE) && instr.arg < 0) {
+            error = "negative memory address " + std::to_string(instr.arg);
+            return false;
+        }
+    }
+
+    std::unordered_map<std::string, int> labels;
+    auto name = [](const Instr& instr) {
+        return std::string(instr.label) + (instr.arg >= 0 ? std::to_string(instr.arg) : "");
+    };
+    for (size_t i = 0; i < code.size(); i++) {
+        if (code[i].op == OP_LABEL) labels[name(code[i])] = static_cast<int>(i);
+    }
+    for (size_t i = 0; i < code.size(); i++) {
+        if (code[i].op != OP_JMP && code[i].op != OP_JNZ) continue;
+        auto it = labels.find(name(code[i]));
+        if (it == labels.end()) {
+            error = "undefined label " + name(code[i]);
+            return false;
+        }
+        target[i] = it->second;
+    }
+    return true;
+}
+
+bool Simulator::run(uint64_t maxSteps, std::string& error) {
+    size_t pc = 0;
+    while (pc < code.size()) {
+        const Instr& instr = code[pc];
+        size_t next = pc + 1;
+        if (instr.op != OP_LABEL) {
+            if (stats.instructions == maxSteps) {
+                error = "stopped after " + std::to_string(maxSteps) + " instructions";
+                return false;
+            }
+            stats.instructions++;
+            stats.byOpcode[instr.op]++;
+        }
+
+        int& reg = instr.reg == 'B' ? regB : regA;
+        switch (instr.op) {
+            case OP_LDI:
+                reg = instr.arg;
+                stats.cycles += 1;
+                break;
+            case OP_LOAD:
+                reg = memory[instr.arg];
+                touched[instr.arg] = 1;
+                stats.memReads++;
+                stats.cycles += 2;
+                break;
+            case OP_STORE:
+                memory[instr.arg] = regA;
+                touched[instr.arg] = 1;
+                stats.memWrites++;
+                stats.cycles += 2;
+                break;
+            case OP_MOV_BA:
+                regB = regA;
+                stats.cycles += 1;
+                break;
+            case OP_ADD:
+                regA = static_cast<int>(static_cast<unsigned>(regA) + static_cast<unsigned>(regB));
+                stats.cycles += 1;
+                break;
+            case OP_SUB:
+                regA = static_cast<int>(static_cast<unsigned>(regA) - static_cast<unsigned>(regB));
+                stats.cycles += 1;
+                break;
+            case OP_CMP:
+                zero = regA == regB;
+                stats.cycles += 1;
+                break;
+            case OP_JMP:
+                stats.jumps++;
+                stats.cycles += 2;
+                next = target[pc];
+                break;
+            case OP_JNZ:
+                stats.branches++;
+                if (!zero) {
+                    stats.branchesTaken++;
+                    stats.cycles += 2;
+                    next = target[pc];
+                } else {
+                    stats.cycles += 1;
+                }
+                break;
+            case OP_LABEL:
+                break;
+            case OP_HLT:
+                stats.cycles += 1;
+                return true;
+            case OP_COUNT:
+                break;
+        }
+        pc = next;
+    }
+    return true;
+}
+
+void Simulator::report(std::ostream& out) const {
+    out << "Cycles: " << stats.cycles << "\n";
+    out << "Instructions: " << stats.instructions << " (";
+    bool first = true;
+    for (int op = 0; op < OP_COUNT; op++) {
+        if (op == OP_LABEL || !stats.byOpcode[op]) continue;
+        out << (first ? "" : ", ") << opcodeName(static_cast<Opcode>(op)) << " " << stats.byOpcode[op];
+        first = false;
+    }
+    out << ")\n";
+    out << "Memory traffic: " << stats.memReads << " reads, " << stats.memWrites << " writes\n";
+    out << "Branches: " << stats.branches << " jnz (" << stats.branchesTaken << " taken), "
+        << stats.jumps << " jmp\n";
+    out << "Registers: A=" << regA << " B=" << regB << " Z=" << (zero ? 1 : 0) << "\n";
+    out << "Memory:\n";
+    for (size_t addr = 0; addr < memory.size(); addr++) {
+        if (touched[addr]) out << "  [" << addr << "] = " << memory[addr] << "\n";
+    }
+}
@@ -0,0 +1,168 @@
+#include "slot_alloc.h"
+#include "ast.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <vector>
+
+
+namespace {
+
+// Statements are numbered in source order, which is also the order every
+// path through the program visits them: no jump ever goes backwards. Each
+// statement has a use point (2n) followed by a def point (2n + 1), so a
+// variable last read by the statement that assigns another can hand its
+// address straight over. An if counts as one statement, numbered before its
+// arms; its condition is read at that statement's use point.
+class LiveIntervals {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    std::vector<uint32_t> start;
+    std::vector<uint32_t> end;
+    std::vector<uint8_t> assigned;  // definitely assigned on every path here
+    std::vector<uint32_t> assignLog;
+    uint32_t stmt = 0;
+
+    struct OpenIf {
+        size_t mark;
+        std::vector<uint32_t> thenAssigned;
+    };
+    std::vector<OpenIf> openIfs;
+    TreeWalker walker;
+
+    LiveIntervals(size_t symbols)
+        : start(symbols, NONE), end(symbols, 0), assigned(symbols, 0) {}
+
+    void touch(uint32_t sym, uint32_t point) {
+        start[sym] = std::min(start[sym], point);
+        end[sym] = std::max(end[sym], point);
+    }
+
+    void def(uint32_t sym) {
+        touch(sym, 2 * stmt + 1);
+        if (!assigned[sym]) {
+            assigned[sym] = 1;
+            assignLog.push_back(sym);
+        }
+    }
+
+    // Undoes the assignments made since `mark` and returns their symbols, sorted.
+    std::vector<uint32_t> rollback(size_t mark) {
+        std::vector<uint32_t> syms(assignLog.begin() + mark, assignLog.end());
+        for (uint32_t sym : syms) assigned[sym] = 0;
+        assignLog.resize(mark);
+        std::sort(syms.begin(), syms.end());
+        return syms;
+    }
+
+    void statement(VarDecl*) {
+        stmt++;
+    }
+
+    void statement(VarDeclAssign* node) {
+        stmt++;
+        walker.expression(node->expr, *this);
+        def(node->sym);
+    }
+
+    void statement(AssignStmt* node) {
+        stmt++;
+        walker.expression(node->expr, *this);
+        def(node->sym);
+    }
+
+    // Only what both arms assign is assigned after the if.
+    void beginIf(IfStmt* node) {
+        stmt++;
+        walker.expression(node->condition, *this);
+        openIfs.push_back({assignLog.size(), {}});
+    }
+
+    void elseIf(IfStmt*) {
+        OpenIf& open = openIfs.back();
+        open.thenAssigned = rollback(open.mark);
+    }
+
+    void endIf(IfStmt*) {
+        OpenIf& open = openIfs.back();
+        auto elseAssigned = rollback(open.mark);
+
+        std::vector<uint32_t> both;
+        std::set_intersection(open.thenAssigned.begin(), open.thenAssigned.end(),
+                              elseAssigned.begin(), elseAssigned.end(),
+                              std::back_inserter(both));
+        for (uint32_t sym : both) {
+            assigned[sym] = 1;
+            assignLog.push_back(sym);
+        }
+        openIfs.pop_back();
+    }
+
+    void leaf(Identifier* node) {
+        // A read that some path reaches without an assignment sees whatever
+        // the variable's address held when the program started.
+        if (!assigned[node->sym]) touch(node->sym, 0);
+        touch(node->sym, 2 * stmt);
+    }
+
+    void leaf(NumberLiteral*) {}
+    void binary(BinaryExpr*) {}
+};
+
+}
+
+
+SlotStats allocateSlots(Program& program, CompilationContext& ctx,
+                        const std::vector<uint8_t>& outputs) {
+    size_t symbols = ctx.symbols.size();
+    LiveIntervals live(symbols);
+    live.walker.statements(program.statements, live);
+
+    // The outputs' final values are read at the exit, like any other read.
+    uint32_t exitPoint = 2 * live.stmt + 2;
+    for (uint32_t sym = 0; sym < symbols; sym++) {
+        if (!outputs[sym] || live.start[sym] == LiveIntervals::NONE) continue;
+        if (!live.assigned[sym]) live.touch(sym, 0);
+        live.touch(sym, exitPoint);
+    }
+
+    SlotStats stats;
+    stats.slotsBefore = symbols;
+
+    std::vector<uint32_t> order;
+    for (uint32_t sym = 0; sym < symbols; sym++) {
+        if (live.start[sym] != LiveIntervals::NONE) order.push_back(sym);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](uint32_t a, uint32_t b) { return live.start[a] < live.start[b]; });
+    stats.variables = order.size();
+
+    // Linear scan: walk the intervals by start point, release the addresses
+    // of intervals that have ended, and always take the lowest free address
+    // so the result does not depend on anything but the program.
+    typedef std::pair<uint32_t, int> Active;    // (end point, address)
+    std::priority_queue<Active, std::vector<Active>, std::greater<Active>> active;
+    std::priority_queue<int, std::vector<int>, std::greater<int>> freeSlots;
+    int nextSlot = 1;                           // address 0 is left unused
+
+    ctx.slots.assign(symbols, 0);
+    for (uint32_t sym : order) {
+        while (!active.empty() && active.top().first < live.start[sym]) {
+            freeSlots.push(active.top().second);
+            active.pop();
+        }
+        int slot;
+        if (freeSlots.empty()) {
+            slot = nextSlot++;
+        } else {
+            slot = freeSlots.top();
+            freeSlots.pop();
+        }
+        ctx.slots[sym] = slot;
+        active.push({live.end[sym], slot});
+    }
+
+    stats.slotsAfter = static_cast<size_t>(nextSlot - 1);
+    return stats;
+}
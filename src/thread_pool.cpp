@@ -0,0 +1,139 @@
+#include "thread_pool.h"
+
+
+namespace {
+
+// Index of the pool worker running on this thread, or -1 outside the pool.
+thread_local int currentWorker = -1;
+thread_local const void* currentPool = nullptr;
+
+}
+
+
+ThreadPool::ThreadPool(unsigned threads)
+    : queued(0), pending(0), stopping(false) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    for (unsigned i = 0; i < threads; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back([this, i] { run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    Queue& target = currentPool == this ? *queues[currentWorker] : injected;
+
+    // Counted before it is published, so the fetch_sub of the worker that
+    // takes it can never run first and wrap `queued` below zero. A worker
+    // woken in between finds nothing yet and simply looks again.
+    pending.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        queued.fetch_add(1);
+    }
+    {
+        std::lock_guard<std::mutex> guard(target.lock);
+        target.tasks.push_back(std::move(task));
+    }
+    wake.notify_one();
+}
+
+bool ThreadPool::tryPop(unsigned self, std::function<void()>& task) {
+    {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(injected.lock);
+        if (!injected.tasks.empty()) {
+            task = std::move(injected.tasks.front());
+            injected.tasks.pop_front();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < queues.size(); i++) {
+        Queue& victim = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::finish(std::exception_ptr error) {
+    std::lock_guard<std::mutex> guard(stateLock);
+    if (error && !failure) {
+        failure = error;
+    }
+    if (pending.fetch_sub(1) == 1) {
+        idle.notify_all();
+    }
+}
+
+void ThreadPool::run(unsigned self) {
+    currentWorker = static_cast<int>(self);
+    currentPool = this;
+
+    std::function<void()> task;
+    while (true) {
+        if (tryPop(self, task)) {
+            std::exception_ptr error;
+            try {
+                task();
+            } catch (...) {
+                error = std::current_exception();
+            }
+            task = nullptr;
+            finish(error);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(stateLock);
+        wake.wait(guard, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> guard(stateLock);
+    idle.wait(guard, [this] { return pending.load() == 0; });
+
+    if (failure) {
+        std::exception_ptr error = failure;
+        failure = nullptr;
+        std::rethrow_exception(error);
+    }
+}
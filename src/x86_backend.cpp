@@ -0,0 +1,327 @@
+#include "backend.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <string>
+
+
+namespace {
+
+// Variables are kept in 32-bit registers by slot, so the slot sharing done
+// at -O1 doubles as register allocation; slots beyond the register file live
+// in .bss. Nothing is called while they are live, so the list mixes
+// callee-saved and caller-saved registers freely. %eax holds the value being
+// computed and %ecx the second operand when both sides of an operation are
+// subtrees.
+const char* const varRegs[] = {
+    "%ebx", "%ebp", "%esi", "%edi", "%r8d", "%r9d",
+    "%r10d", "%r11d", "%r12d", "%r13d", "%r14d", "%r15d",
+};
+const int VAR_REGS = sizeof(varRegs) / sizeof(varRegs[0]);
+
+enum AluOp { ALU_ADD, ALU_SUB, ALU_CMP };
+const char* const aluNames[] = {"add", "sub", "cmp"};
+
+// Writes "name = value\n" to stdout. In: %rsi name, %rdx name length,
+// %eax value. Clobbers everything but the stack.
+const char* const printRoutine =
+    "slc_print:\n"
+    "    push %rbp\n"
+    "    mov %rsp, %rbp\n"
+    "    sub $32, %rsp\n"
+    "    mov %eax, %r8d\n"
+    "    mov $1, %edi\n"
+    "    mov $1, %eax\n"
+    "    syscall\n"
+    "    lea -1(%rbp), %rdi\n"
+    "    movb $10, (%rdi)\n"
+    "    mov %r8d, %eax\n"
+    "    test %eax, %eax\n"
+    "    jns 1f\n"
+    "    neg %eax\n"
+    "1:  mov $10, %ecx\n"
+    "2:  xor %edx, %edx\n"
+    "    div %ecx\n"
+    "    add $48, %dl\n"
+    "    dec %rdi\n"
+    "    mov %dl, (%rdi)\n"
+    "    test %eax, %eax\n"
+    "    jnz 2b\n"
+    "    test %r8d, %r8d\n"
+    "    jns 3f\n"
+    "    dec %rdi\n"
+    "    movb $45, (%rdi)\n"
+    "3:  sub $3, %rdi\n"
+    "    movb $32, (%rdi)\n"
+    "    movb $61, 1(%rdi)\n"
+    "    movb $32, 2(%rdi)\n"
+    "    mov %rdi, %rsi\n"
+    "    mov %rbp, %rdx\n"
+    "    sub %rdi, %rdx\n"
+    "    mov $1, %edi\n"
+    "    mov $1, %eax\n"
+    "    syscall\n"
+    "    leave\n"
+    "    ret\n";
+
+// Slot 0 is never written; a variable that no code is left to touch after
+// the -O1 passes is read from there and so reads as 0.
+std::string location(const CompilationContext& ctx, uint32_t sym) {
+    int slot = ctx.slot(sym);
+    if (slot > 0 && slot - 1 < VAR_REGS) return varRegs[slot - 1];
+    return "slc_mem+" + std::to_string(4 * slot) + "(%rip)";
+}
+
+// Writes the code of a run of blocks. Nothing carries over from one block
+// to the next, so runs can be written independently of each other.
+class BlockWriter {
+private:
+    const IrProgram* ir;
+    const CompilationContext* ctx;
+    const IrBlock* block = nullptr;
+    int tempBase;
+    std::vector<int> defIndex;
+    OutputWriter* out;
+
+    std::string operand(const IrValue& value) const {
+        if (value.kind == IrValue::CONST) return "$" + std::to_string(value.id);
+        return location(*ctx, static_cast<uint32_t>(value.id));
+    }
+
+    std::string label(int target) const {
+        const IrBlock& b = ir->blocks[target];
+        if (b.labelPrefix) return ".L" + std::string(b.labelPrefix) + std::to_string(b.labelId);
+        return ".Lbb_" + std::to_string(target);
+    }
+
+    static bool isLeaf(const IrValue& value) {
+        return value.kind != IrValue::TEMP;
+    }
+
+    // Trees are emitted from an explicit stack of steps, pushed in reverse,
+    // as in the ABM code generator.
+    struct Step {
+        enum Kind { EVAL, OP_LEAF, OP_ECX, TEXT };
+        Kind kind;
+        const char* text;       // the operator, or the whole line for TEXT
+        IrValue value;
+    };
+    std::vector<Step> steps;
+
+    void push(Step::Kind kind, const char* text, const IrValue& value = IrValue()) {
+        steps.push_back({kind, text, value});
+    }
+
+    void run() {
+        while (!steps.empty()) {
+            Step step = steps.back();
+            steps.pop_back();
+            switch (step.kind) {
+                case Step::EVAL:
+                    if (isLeaf(step.value)) {
+                        *out << "    mov " << operand(step.value) << ", %eax\n";
+                    } else {
+                        pushInstruction(block->code[defIndex[step.value.id - tempBase]]);
+                    }
+                    break;
+                case Step::OP_LEAF:
+                    *out << "    " << step.text << " " << operand(step.value) << ", %eax\n";
+                    break;
+                case Step::OP_ECX:
+                    *out << "    " << step.text << " %ecx, %eax\n";
+                    break;
+                case Step::TEXT:
+                    *out << step.text;
+                    break;
+            }
+        }
+    }
+
+    void pushInstruction(const IrInstr& instr) {
+        if (instr.op == IR_COPY) {
+            push(Step::EVAL, nullptr, instr.a);
+        } else {
+            pushOperation(instr.op == IR_ADD ? ALU_ADD : ALU_SUB, instr.a, instr.b);
+        }
+    }
+
+    // %eax = lhs op rhs; for cmp only the flags matter.
+    void pushOperation(AluOp alu, const IrValue& lhs, const IrValue& rhs) {
+        const char* op = aluNames[alu];
+        bool commutative = alu != ALU_SUB;
+        if (isLeaf(rhs)) {
+            push(Step::OP_LEAF, op, rhs);
+            push(Step::EVAL, nullptr, lhs);
+        } else if (isLeaf(lhs) && commutative) {
+            push(Step::OP_LEAF, op, lhs);
+            push(Step::EVAL, nullptr, rhs);
+        } else {
+            push(Step::OP_ECX, op);
+            if (isLeaf(lhs)) {
+                push(Step::EVAL, nullptr, lhs);
+                push(Step::TEXT, "    mov %eax, %ecx\n");
+            } else {
+                push(Step::TEXT, "    pop %rcx\n");
+                push(Step::EVAL, nullptr, lhs);
+                push(Step::TEXT, "    push %rax\n");
+            }
+            push(Step::EVAL, nullptr, rhs);
+        }
+    }
+
+    void instruction(const IrInstr& instr) {
+        pushInstruction(instr);
+        run();
+    }
+
+    void operation(AluOp op, const IrValue& lhs, const IrValue& rhs) {
+        pushOperation(op, lhs, rhs);
+        run();
+    }
+
+    void store(const IrInstr& instr) {
+        std::string dst = location(*ctx, static_cast<uint32_t>(instr.dst.id));
+        bool dstReg = dst[0] == '%';
+        if (instr.op == IR_COPY && isLeaf(instr.a) && (dstReg || instr.a.kind == IrValue::CONST)) {
+            *out << "    movl " << operand(instr.a) << ", " << dst << "\n";
+            return;
+        }
+        instruction(instr);
+        *out << "    mov %eax, " << dst << "\n";
+    }
+
+    void emitBlock(int index) {
+        block = &ir->blocks[index];
+        for (size_t k = 0; k < block->code.size(); k++) {
+            const IrInstr& instr = block->code[k];
+            if (instr.dst.kind == IrValue::TEMP) {
+                defIndex[instr.dst.id - tempBase] = static_cast<int>(k);
+            } else {
+                store(instr);
+            }
+        }
+
+        const IrTerminator& term = block->term;
+        int next = index + 1;
+        switch (term.kind) {
+            case IR_HALT:
+                if (next != static_cast<int>(ir->blocks.size())) *out << "    jmp .Lslc_halt\n";
+                break;
+            case IR_GOTO:
+                if (term.target != next) *out << "    jmp " << label(term.target) << "\n";
+                break;
+            case IR_BRANCH:
+                operation(ALU_CMP, term.a, term.b);
+                *out << "    jne " << label(term.other) << "\n";
+                if (term.target != next) *out << "    jmp " << label(term.target) << "\n";
+                break;
+        }
+    }
+
+public:
+    BlockWriter(const IrProgram& program, const CompilationContext& context,
+                const IrBlockRange& range, OutputWriter& os)
+        : ir(&program), ctx(&context), tempBase(range.firstTemp),
+          defIndex(range.endTemp - range.firstTemp, -1), out(&os) {}
+
+    void write(const IrBlockRange& range, const std::vector<uint8_t>& jumpedTo) {
+        for (int i = range.begin; i < range.end; i++) {
+            if (ir->blocks[i].labelPrefix || jumpedTo[i]) *out << label(i) << ":\n";
+            emitBlock(i);
+        }
+    }
+};
+
+class X86Backend : public Backend {
+public:
+    X86Backend() {}
+
+    void generate(const IrProgram& program, const CompilationContext& context,
+                  const std::vector<uint8_t>& outputs,
+                  OutputWriter& os, std::ostream* log, ThreadPool* pool) override {
+        // Every output is printed, whether or not the passes left code that
+        // touches it, so the set printed does not depend on -O.
+        std::vector<uint32_t> printed;
+        for (uint32_t sym = 0; sym < outputs.size(); sym++) {
+            if (outputs[sym]) printed.push_back(sym);
+        }
+
+        os << "# Generated by slcompiler --target=x86_64\n"
+           << "# gcc -nostdlib -static -o prog out.s\n"
+           << "    .text\n"
+           << "    .globl _start\n"
+           << "_start:\n";
+        for (int r = 0; r < VAR_REGS && r + 1 < context.firstFreeSlot(); r++) {
+            os << "    xor " << varRegs[r] << ", " << varRegs[r] << "\n";
+        }
+        std::vector<uint8_t> jumpedTo(program.blocks.size(), 0);
+        for (const IrBlock& b : program.blocks) {
+            if (b.term.target >= 0) jumpedTo[b.term.target] = 1;
+            if (b.term.other >= 0) jumpedTo[b.term.other] = 1;
+        }
+
+        std::vector<uint8_t> anywhere(program.blocks.size(), 1);
+        std::vector<IrBlockRange> ranges = splitBlocks(program, pool, anywhere);
+        std::vector<std::unique_ptr<OutputWriter>> texts;
+        if (ranges.size() > 1) {
+            texts.resize(ranges.size());
+            for (size_t i = 0; i < ranges.size(); i++) {
+                pool->submit([&, i] {
+                    texts[i] = std::make_unique<OutputWriter>();
+                    BlockWriter(program, context, ranges[i], *texts[i]).write(ranges[i], jumpedTo);
+                });
+            }
+            pool->wait();
+        } else {
+            BlockWriter(program, context, ranges[0], os).write(ranges[0], jumpedTo);
+        }
+
+        // The rest goes behind the last part, so that parts generated on the
+        // pool are written out with the header in one go.
+        OutputWriter& tail = texts.empty() ? os : *texts.back();
+
+        // Registers do not survive the print routine, so save the outputs first.
+        tail << ".Lslc_halt:\n";
+        for (size_t k = 0; k < printed.size(); k++) {
+            tail << "    movl " << location(context, printed[k]) << ", %eax\n"
+                 << "    mov %eax, slc_out+" << 4 * k << "(%rip)\n";
+        }
+        for (size_t k = 0; k < printed.size(); k++) {
+            tail << "    mov slc_out+" << 4 * k << "(%rip), %eax\n"
+                 << "    lea slc_name" << k << "(%rip), %rsi\n"
+                 << "    mov $" << context.symbols.name(printed[k]).size() << ", %edx\n"
+                 << "    call slc_print\n";
+        }
+        tail << "    mov $60, %eax\n"
+             << "    xor %edi, %edi\n"
+             << "    syscall\n\n"
+             << printRoutine << "\n"
+             << "    .section .rodata\n";
+        for (size_t k = 0; k < printed.size(); k++) {
+            tail << "slc_name" << k << ": .ascii \"" << context.symbols.name(printed[k]) << "\"\n";
+        }
+        tail << "    .bss\n"
+             << "    .align 4\n"
+             << "slc_mem: .zero " << 4 * (context.firstFreeSlot() + 1) << "\n"
+             << "slc_out: .zero " << 4 * (printed.size() + 1) << "\n";
+
+        if (!texts.empty()) {
+            std::vector<std::string_view> views;
+            for (const auto& text : texts) views.push_back(text->text());
+            os.writeParts(views.data(), views.size());
+        }
+
+        if (log) {
+            int slots = context.firstFreeSlot() - 1;
+            *log << "x86_64: " << std::min(slots, VAR_REGS) << " variable slots in registers, "
+                 << std::max(slots - VAR_REGS, 0) << " in memory, "
+                 << printed.size() << " outputs printed at exit\n";
+        }
+    }
+};
+
+}
+
+
+std::unique_ptr<Backend> makeX86Backend() {
+    return std::make_unique<X86Backend>();
+}
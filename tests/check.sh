@@ -0,0 +1,40 @@
+#!/bin/sh
+# Compiles every tests/*.c at -O0 and -O1 for x86_64, runs both and checks
+# that they print the same variables, and what tests/NAME.expected lists when
+# it exists. Every program must also run on the simulator at both levels.
+# Usage: tests/check.sh [compiler]
+
+compiler=${1:-./slcompiler}
+work=$(mktemp -d) || exit 1
+trap 'rm -rf "$work"' EXIT
+failed=0
+
+for source in tests/*.c; do
+    name=$(basename "$source" .c)
+    for level in O0 O1; do
+        if ! "$compiler" -$level --target=x86_64 "$source" "$work/$name.$level.s" > /dev/null ||
+           ! gcc -nostdlib -static -o "$work/$name.$level" "$work/$name.$level.s" ||
+           ! "$work/$name.$level" | sort > "$work/$name.$level.out"; then
+            echo "FAIL $name: x86_64 -$level did not build or run"
+            failed=1
+        fi
+        if ! "$compiler" -$level "$source" "$work/$name.$level.asm" > /dev/null ||
+           ! "$compiler" --run "$work/$name.$level.asm" > /dev/null; then
+            echo "FAIL $name: abm -$level did not build or run"
+            failed=1
+        fi
+    done
+    if ! cmp -s "$work/$name.O0.out" "$work/$name.O1.out"; then
+        echo "FAIL $name: -O0 and -O1 disagree"
+        diff "$work/$name.O0.out" "$work/$name.O1.out"
+        failed=1
+    elif [ -f "tests/$name.expected" ] && ! cmp -s "tests/$name.expected" "$work/$name.O1.out"; then
+        echo "FAIL $name: output differs from tests/$name.expected"
+        diff "tests/$name.expected" "$work/$name.O1.out"
+        failed=1
+    else
+        echo "ok   $name"
+    fi
+done
+
+exit $failed
@@ -0,0 +1,9 @@
+int a;
+if (x == y) {
+    int t = x + 7;
+    int u = x + 8;
+    b = t + u;
+}
+if (x == 1) {
+    a = 5;
+}